@@ -12,11 +12,3 @@ pbc_static {
 }
 
 LIBS        += -lgmp
-
-config_sha512 {
-    HEADERS     += sha512.h
-    SOURCES     += sha512.cpp
-} else {
-    HEADERS     += sha256.h
-    SOURCES     += sha256.cpp
-}
@@ -16,7 +16,9 @@
 #define SAMPLES 2
 
 #define HASH_SAMPLE_SIZE        1000000
+#define HASH_BATCH_SIZE         16
 #define PAIRING_SAMPLE_SIZE     500
+#define PRIV_CRS_BATCH_SIZE     10
 
 using namespace std;
 using namespace gsnizk;
@@ -76,6 +78,24 @@ void benchmarkHashes() {
                    data[j] = static_cast<char>(rand() & 0xFF);)
     pairings::getHash(data, rand() % 257, hash);
     END_TASK()
+    delete[] hash;
+    delete[] data;
+    /* Same number of hashes, HASH_BATCH_SIZE messages at a time */
+    hash = new char[pairings::getHashLen() * HASH_BATCH_SIZE];
+    data = new char[256 * HASH_BATCH_SIZE];
+    const char *msgs[HASH_BATCH_SIZE];
+    int lens[HASH_BATCH_SIZE];
+    for (int i = 0; i < HASH_BATCH_SIZE; ++i)
+        msgs[i] = data + 256 * i;
+    BEGIN_TASK("Hashes-Batched", HASH_SAMPLE_SIZE / HASH_BATCH_SIZE,
+               for (int j = 256 * HASH_BATCH_SIZE; j-- > 0;)
+                   data[j] = static_cast<char>(rand() & 0xFF);)
+    for (int j = 0; j < HASH_BATCH_SIZE; ++j)
+        lens[j] = rand() % 257;
+    pairings::getHashMany(msgs, lens, HASH_BATCH_SIZE, hash);
+    END_TASK()
+    delete[] hash;
+    delete[] data;
 }
 
 void benchmarkPairings() {
@@ -288,6 +308,37 @@ void benchmarkProofs() {
         in.close();
     }
     remove("priv-crs.benchmark");
+    {
+        /* Same number of private CRS, PRIV_CRS_BATCH_SIZE at a time (the
+         * index goes on from one sample to the next, as with push_back) */
+        vector<CRS> batch(SAMPLES * 50);
+        {
+            ofstream out("priv-crs.benchmark");
+            cout << "Batched private CRS:" << endl << " * 1/2: ";
+            int i = 0;
+            BEGIN_TASK("Private-CRS-Gen-Batched", 50 / PRIV_CRS_BATCH_SIZE,)
+            crs.genPrivateMany(out, PRIV_CRS_BATCH_SIZE,
+                               &batch[PRIV_CRS_BATCH_SIZE * (i++)]);
+            END_TASK()
+            out.close();
+        }
+        {
+            ifstream in("priv-crs.benchmark");
+            cout << " * 2/2: ";
+            int i = 0;
+            BEGIN_TASK("Private-CRS-Check-Batched",
+                       50 / PRIV_CRS_BATCH_SIZE,)
+            if (!crs.checkPrivateMany(in, &batch[PRIV_CRS_BATCH_SIZE * (i++)],
+                                      PRIV_CRS_BATCH_SIZE)) {
+                cerr << "Error: verification of the private CRS failed"
+                     << endl;
+                return;
+            }
+            END_TASK()
+            in.close();
+        }
+        remove("priv-crs.benchmark");
+    }
     crspriv = crsprivs.front();
     crsprivs.clear();
     crspub = crspriv;
@@ -378,6 +429,8 @@ void benchmarkProofs() {
 
 void benchmarkLibrary() {
     b_out = new ofstream("benchmark");
+    /* Same random values on each run, for reproducible measures */
+    pairings::setRandomSeed("benchmark", 9);
     benchmarkHashes();
     benchmarkPairings();
     benchmarkProofs();
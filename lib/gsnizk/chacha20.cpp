@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2016, Remi Bazin <bazin.remi@gmail.com>
+ * See LICENSE for licensing details.
+ */
+
+#include "chacha20.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#define CHACHA20_SSE2
+#include <emmintrin.h>
+#endif
+
+#define ROTL(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTER_ROUND(a,b,c,d) \
+    a += b; d ^= a; d = ROTL(d,16); \
+    c += d; b ^= c; b = ROTL(b,12); \
+    a += b; d ^= a; d = ROTL(d,8); \
+    c += d; b ^= c; b = ROTL(b,7);
+
+static void init_state(uint32_t *st, const uint32_t *key, uint64_t nonce,
+                       uint64_t counter) {
+    st[0] = 0x61707865UL;
+    st[1] = 0x3320646eUL;
+    st[2] = 0x79622d32UL;
+    st[3] = 0x6b206574UL;
+    memcpy(st + 4, key, 32);
+    st[12] = (uint32_t) counter;
+    st[13] = (uint32_t) (counter >> 32);
+    st[14] = (uint32_t) nonce;
+    st[15] = (uint32_t) (nonce >> 32);
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char) v;
+    p[1] = (unsigned char) (v >> 8);
+    p[2] = (unsigned char) (v >> 16);
+    p[3] = (unsigned char) (v >> 24);
+}
+
+static void block(const uint32_t *st, unsigned char *out) {
+    uint32_t x[16];
+    memcpy(x, st, 64);
+    for (int i = 0; i < 10; ++i) {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12])
+        QUARTER_ROUND(x[1], x[5], x[9], x[13])
+        QUARTER_ROUND(x[2], x[6], x[10], x[14])
+        QUARTER_ROUND(x[3], x[7], x[11], x[15])
+        QUARTER_ROUND(x[0], x[5], x[10], x[15])
+        QUARTER_ROUND(x[1], x[6], x[11], x[12])
+        QUARTER_ROUND(x[2], x[7], x[8], x[13])
+        QUARTER_ROUND(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; ++i)
+        store_le32(out + 4 * i, x[i] + st[i]);
+}
+
+#ifdef CHACHA20_SSE2
+#define V_ROTL(x,n) _mm_or_si128(_mm_slli_epi32(x,n), _mm_srli_epi32(x,32-n))
+
+#define V_QUARTER_ROUND(a,b,c,d) \
+    a = _mm_add_epi32(a,b); d = _mm_xor_si128(d,a); d = V_ROTL(d,16); \
+    c = _mm_add_epi32(c,d); b = _mm_xor_si128(b,c); b = V_ROTL(b,12); \
+    a = _mm_add_epi32(a,b); d = _mm_xor_si128(d,a); d = V_ROTL(d,8); \
+    c = _mm_add_epi32(c,d); b = _mm_xor_si128(b,c); b = V_ROTL(b,7);
+
+/* Four consecutive blocks at once, block j in lane j of each word */
+static void blocks4(uint32_t *st, unsigned char *out) {
+    __m128i s[16], x[16];
+    for (int i = 0; i < 16; ++i)
+        s[i] = _mm_set1_epi32((int) st[i]);
+    uint64_t counter = st[12] | (((uint64_t) st[13]) << 32);
+    uint32_t lo[4], hi[4];
+    for (int j = 0; j < 4; ++j) {
+        lo[j] = (uint32_t) (counter + j);
+        hi[j] = (uint32_t) ((counter + j) >> 32);
+    }
+    s[12] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo));
+    s[13] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi));
+    memcpy(x, s, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        V_QUARTER_ROUND(x[0], x[4], x[8], x[12])
+        V_QUARTER_ROUND(x[1], x[5], x[9], x[13])
+        V_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+        V_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+        V_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+        V_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+        V_QUARTER_ROUND(x[2], x[7], x[8], x[13])
+        V_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; i += 4) {
+        /* Transposes words i to i+3 of the four blocks */
+        __m128i a = _mm_add_epi32(x[i], s[i]);
+        __m128i b = _mm_add_epi32(x[i + 1], s[i + 1]);
+        __m128i c = _mm_add_epi32(x[i + 2], s[i + 2]);
+        __m128i d = _mm_add_epi32(x[i + 3], s[i + 3]);
+        __m128i ab0 = _mm_unpacklo_epi32(a, b), ab1 = _mm_unpackhi_epi32(a, b);
+        __m128i cd0 = _mm_unpacklo_epi32(c, d), cd1 = _mm_unpackhi_epi32(c, d);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i),
+                         _mm_unpacklo_epi64(ab0, cd0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 64 + 4 * i),
+                         _mm_unpackhi_epi64(ab0, cd0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 128 + 4 * i),
+                         _mm_unpacklo_epi64(ab1, cd1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 192 + 4 * i),
+                         _mm_unpackhi_epi64(ab1, cd1));
+    }
+    counter += 4;
+    st[12] = (uint32_t) counter;
+    st[13] = (uint32_t) (counter >> 32);
+}
+#endif /* CHACHA20_SSE2 */
+
+void chacha20_blocks(const uint32_t *key, uint64_t nonce, uint64_t counter,
+                     unsigned char *out, size_t n) {
+    uint32_t st[16];
+    init_state(st, key, nonce, counter);
+#ifdef CHACHA20_SSE2
+    for (; n >= 4; n -= 4, out += 256)
+        blocks4(st, out);
+#endif
+    for (; n > 0; --n, out += 64) {
+        block(st, out);
+        if (!++st[12])
+            ++st[13];
+    }
+}
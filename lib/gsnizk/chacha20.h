@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2016, Remi Bazin <bazin.remi@gmail.com>
+ * See LICENSE for licensing details.
+ */
+
+#ifndef CHACHA20_H
+#define CHACHA20_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Generates some ChaCha20 keystream blocks.
+ *
+ * The blocks use the original layout of the ChaCha20 state, with
+ * a 64-bit block counter followed by a 64-bit nonce. The parameter
+ * @p out should point to some accessible space containing at least
+ * 64 * @p n available bytes.
+ *
+ * @param key Key, as 8 little-endian 32-bit words.
+ * @param nonce Nonce of the stream.
+ * @param counter Index of the first block to generate.
+ * @param out Pointer to where the blocks are to be stored.
+ * @param n Number of blocks to generate.
+ */
+void chacha20_blocks(const uint32_t *key, uint64_t nonce, uint64_t counter,
+                     unsigned char *out, size_t n);
+
+#endif /* End of CHACHA20_H */
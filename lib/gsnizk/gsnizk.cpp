@@ -5,6 +5,11 @@
 
 #include "gsnizk.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
 #include <unordered_map>
 
 /* Prioritize Qt's no-debug policy, if existent */
@@ -274,6 +279,8 @@ std::shared_ptr<GTData> createDup(GTData *p, DupTable &dupTable);
 
 std::shared_ptr<FpData> getDup(const std::shared_ptr<FpData> &p,
         DupTable &dupTable) {
+    /* Default right hand sides are empty until endEquations() */
+    if (!p) return p;
     std::unordered_map<FpData*,std::shared_ptr<FpData> >::const_iterator it =
             dupTable.dupFp.find(p.get());
     if (it == dupTable.dupFp.end()) {
@@ -287,6 +294,7 @@ std::shared_ptr<FpData> getDup(const std::shared_ptr<FpData> &p,
 
 std::shared_ptr<G1Data> getDup(const std::shared_ptr<G1Data> &p,
         DupTable &dupTable) {
+    if (!p) return p;
     std::unordered_map<G1Data*,std::shared_ptr<G1Data> >::const_iterator it =
             dupTable.dupG1.find(p.get());
     if (it == dupTable.dupG1.end()) {
@@ -300,6 +308,7 @@ std::shared_ptr<G1Data> getDup(const std::shared_ptr<G1Data> &p,
 
 std::shared_ptr<G2Data> getDup(const std::shared_ptr<G2Data> &p,
         DupTable &dupTable) {
+    if (!p) return p;
     std::unordered_map<G2Data*,std::shared_ptr<G2Data> >::const_iterator it =
             dupTable.dupG2.find(p.get());
     if (it == dupTable.dupG2.end()) {
@@ -313,6 +322,7 @@ std::shared_ptr<G2Data> getDup(const std::shared_ptr<G2Data> &p,
 
 std::shared_ptr<GTData> getDup(const std::shared_ptr<GTData> &p,
         DupTable &dupTable) {
+    if (!p) return p;
     std::unordered_map<GTData*,std::shared_ptr<GTData> >::const_iterator it =
             dupTable.dupGT.find(p.get());
     if (it == dupTable.dupGT.end()) {
@@ -418,10 +428,15 @@ std::shared_ptr<GTData> createDup(GTData *p, DupTable &dupTable) {
 }
 
 NIZKProof::NIZKProof(const NIZKProof &other)
-    : type(other.type), zk(other.zk), fixed(other.fixed),
+    : type(other.type), weights(other.weights), preferZK(other.preferZK),
+    format(other.format), compressedPoints(other.compressedPoints),
+    optimizedFpPlacement(other.optimizedFpPlacement), fpPreset(other.fpPreset),
+    presetVarsFp(other.presetVarsFp), presetCstsFp(other.presetCstsFp),
+    zk(other.zk), fixed(other.fixed),
     varsFpInB1(other.varsFpInB1), cstsFpInB1(other.cstsFpInB1),
     sEnc(other.sEnc), tFp(other.tFp), tG1(other.tG1), tG2(other.tG2),
-    tGT(other.tGT) {
+    tGT(other.tGT), checkOrder(other.checkOrder),
+    statementHash(other.statementHash) {
     DupTable dupTable;
     int size;
     eqsFp.reserve(size = other.eqsFp.size());
@@ -478,6 +493,14 @@ NIZKProof::NIZKProof(const NIZKProof &other)
     }
 }
 
+NIZKProof &NIZKProof::operator=(const NIZKProof &other) {
+    if (this != &other) {
+        this->~NIZKProof();
+        new (this) NIZKProof(other);
+    }
+    return *this;
+}
+
 void NIZKProof::addEquation(const FpElement &leftHandSide,
                             const FpElement &rightHandSide) {
     if (fixed) throw "Unexpected use of gsnizk::addEquation";
@@ -947,9 +970,20 @@ void endRewriteLeft(const G1Data &d);
 void endRewriteRight(const FpData &d);
 void endRewriteRight(const G2Data &d);
 
+template <typename T> inline void endRewrite(const std::vector<T> &eqs) {
+    for (int i = eqs.size(); i-- > 0;) {
+        endRewrite(*eqs[i].first);
+        endRewrite(*eqs[i].second);
+    }
+}
+
 bool NIZKProof::endEquations() {
     /* Subsequent calls are ignored. */
     if (fixed) return true;
+    if (type == Auto)
+        return chooseCommitType();
+    if (optimizedFpPlacement)
+        return optimizeFpPlacement();
     /* Getting indexes, pointers and removing duplicates */
     for (PairFp &p : eqsFp) {
         getIndexes(p.first);
@@ -987,52 +1021,62 @@ bool NIZKProof::endEquations() {
     /* Rewrite equations */
     varsFpInB1.resize(varsFp.size());
     cstsFpInB1.resize(cstsFp.size());
+    if (fpPreset) {
+        /* Sides forced by optimizeFpPlacement(); -1 when left to the
+         * greedy placement */
+        ASSERT((presetVarsFp.size() == varsFp.size()) &&
+               (presetCstsFp.size() == cstsFp.size()),
+               "Array sizes do not match");
+        for (int i = varsFp.size(); i-- > 0;) {
+            if (presetVarsFp[i] < 0) continue;
+            varsFpInB1[i] = presetVarsFp[i];
+            varsFp[i]->d = reinterpret_cast<void*>(new int(-1));
+        }
+        for (int i = cstsFp.size(); i-- > 0;) {
+            if (presetCstsFp[i] < 0) continue;
+            cstsFpInB1[i] = presetCstsFp[i];
+            cstsFp[i]->d = reinterpret_cast<void*>(cstsFp[i].get());
+        }
+    }
     {
         int checkedFp = 0, checkedG1 = 0, checkedG2 = 0, checkedGT = 0;
-        while (true) {
-            if ((checkedFp == (int) eqsFp.size()) &&
-                    (checkedG1 == (int) eqsG1.size()) &&
-                    (checkedG2 == (int) eqsG2.size()) &&
-                    (checkedGT == (int) eqsGT.size())) break;
-            while (checkedFp < (int) eqsFp.size()) {
-                checkoutAsFp(eqsFp[checkedFp].first);
-                checkoutAsFp(eqsFp[checkedFp].second);
-                ++checkedFp;
-            }
-            while (checkedG1 < (int) eqsG1.size()) {
-                checkoutAsG1(eqsG1[checkedG1].first);
-                checkoutAsG1(eqsG1[checkedG1].second);
-                ++checkedG1;
-            }
-            while (checkedG2 < (int) eqsG2.size()) {
-                checkoutAsG2(eqsG2[checkedG2].first);
-                checkoutAsG2(eqsG2[checkedG2].second);
-                ++checkedG2;
-            }
-            while (checkedGT < (int) eqsGT.size()) {
-                checkoutAsGT(eqsGT[checkedGT].first);
-                checkoutAsGT(eqsGT[checkedGT].second);
-                ++checkedGT;
+        try {
+            while (true) {
+                if ((checkedFp == (int) eqsFp.size()) &&
+                        (checkedG1 == (int) eqsG1.size()) &&
+                        (checkedG2 == (int) eqsG2.size()) &&
+                        (checkedGT == (int) eqsGT.size())) break;
+                while (checkedFp < (int) eqsFp.size()) {
+                    checkoutAsFp(eqsFp[checkedFp].first);
+                    checkoutAsFp(eqsFp[checkedFp].second);
+                    ++checkedFp;
+                }
+                while (checkedG1 < (int) eqsG1.size()) {
+                    checkoutAsG1(eqsG1[checkedG1].first);
+                    checkoutAsG1(eqsG1[checkedG1].second);
+                    ++checkedG1;
+                }
+                while (checkedG2 < (int) eqsG2.size()) {
+                    checkoutAsG2(eqsG2[checkedG2].first);
+                    checkoutAsG2(eqsG2[checkedG2].second);
+                    ++checkedG2;
+                }
+                while (checkedGT < (int) eqsGT.size()) {
+                    checkoutAsGT(eqsGT[checkedGT].first);
+                    checkoutAsGT(eqsGT[checkedGT].second);
+                    ++checkedGT;
+                }
             }
+        } catch (const char *) {
+            /* Fp constant used on both sides; release the rewrite data */
+            endRewrite(eqsFp);
+            endRewrite(eqsG1);
+            endRewrite(eqsG2);
+            throw;
         }
-        for (int i = eqsFp.size(); i-- > 0;) {
-            const FpData &left = *eqsFp[i].first;
-            const FpData &right = *eqsFp[i].second;
-            endRewrite(left);
-            endRewrite(right);
-        }
-        for (int i = eqsG1.size(); i-- > 0;) {
-            const G1Data &left = *eqsG1[i].first;
-            const G1Data &right = *eqsG1[i].second;
-            endRewrite(left);
-            endRewrite(right);
-        }
-        for (int i = eqsG2.size(); i-- > 0;) {
-            const G2Data &left = *eqsG2[i].first;
-            const G2Data &right = *eqsG2[i].second;
-            endRewrite(left);
-            endRewrite(right);
-        }
+        endRewrite(eqsFp);
+        endRewrite(eqsG1);
+        endRewrite(eqsG2);
     }
     /* Selected Encryption selection */
     zk = true;
@@ -1105,10 +1149,134 @@ endZKTests:
     }
     /* Equation types for the proofs */
     getEqProofTypes();
+    checkOrder = getCheckOrder();
     fixed = true;
+    getStatementHash();
+    return true;
+}
+
+bool NIZKProof::chooseCommitType() {
+    static const CommitType candidates[3] = {
+        SelectedEncryption, NormalCommit, AllEncrypted
+    };
+    NIZKProof *best = NULL;
+    double bestCost = 0;
+    const char *error = NULL;
+    for (CommitType t : candidates) {
+        NIZKProof *p = new NIZKProof(*this);
+        p->type = t;
+        try {
+            if (!p->endEquations()) {
+                /* Index errors do not depend on the type of commitments */
+                delete p;
+                delete best;
+                return false;
+            }
+        } catch (const char *e) {
+            /* No Zero-Knowledge selected encryption, or an error in the
+             * equations that none of the types can deal with */
+            error = e;
+            delete p;
+            continue;
+        }
+        double cost = weights.getCost(p->getCost());
+        if ((!best) || (preferZK && p->zk && (!best->zk)) ||
+                (((!preferZK) || (p->zk == best->zk)) && (cost < bestCost))) {
+            delete best;
+            best = p;
+            bestCost = cost;
+        } else {
+            delete p;
+        }
+    }
+    if (!best)
+        throw error;
+    *this = *best;
+    delete best;
     return true;
 }
 
+bool NIZKProof::optimizeFpPlacement() {
+    /* Greedy placement, used as a fallback */
+    NIZKProof *best = new NIZKProof(*this);
+    best->optimizedFpPlacement = false;
+    try {
+        if (!best->endEquations()) {
+            delete best;
+            return false;
+        }
+    } catch (const char *) {
+        delete best;
+        throw;
+    }
+    double bestCost = weights.getCost(best->getCost());
+    /* Forced sides of the original scalars; the other ones are placed
+     * greedily, and the products oriented accordingly */
+    std::vector<int> vars(best->varsFp.size() - best->additionalFp.size(), -1);
+    std::vector<int> csts(best->cstsFp.size(), -1);
+    int n = vars.size() + csts.size();
+    /* Local search: force the other side of one scalar at a time,
+     * until no such change is cheaper */
+    for (int last = 0, i = 0; n > 0;) {
+        bool isVar = (i < (int) vars.size());
+        int j = isVar ? i : (i - vars.size());
+        int &side = isVar ? vars[j] : csts[j];
+        int previous = side;
+        side = !(isVar ? best->varsFpInB1[j] : best->cstsFpInB1[j]);
+        NIZKProof *p = new NIZKProof(*this);
+        p->optimizedFpPlacement = false;
+        p->fpPreset = true;
+        p->presetVarsFp = vars;
+        p->presetCstsFp = csts;
+        bool improved = false;
+        try {
+            p->endEquations();
+            double cost = weights.getCost(p->getCost());
+            if (preferZK && (p->zk != best->zk))
+                improved = p->zk;
+            else
+                improved = (cost < bestCost);
+            if (improved) {
+                delete best;
+                best = p;
+                bestCost = cost;
+                last = i;
+            }
+        } catch (const char *) {
+            /* Fp constant on both sides, or no Zero-Knowledge encryption */
+        }
+        if (!improved) {
+            delete p;
+            side = previous;
+        }
+        if ((i = (i + 1) % n) == last)
+            break;
+    }
+    *this = *best;
+    delete best;
+    return true;
+}
+
+void NIZKProof::setCostWeights(const CostWeights &weights, bool preferZK) {
+    this->weights = weights;
+    this->preferZK = preferZK;
+    /* The verification order depends on the weights */
+    if (fixed)
+        checkOrder = getCheckOrder();
+}
+
+void NIZKProof::setOptimizedFpPlacement(bool enabled) {
+    optimizedFpPlacement = enabled;
+}
+
+void NIZKProof::setProofFormat(ProofFormat format) {
+    this->format = format;
+}
+
+void NIZKProof::setPointCompression(bool enabled) {
+    compressedPoints = enabled;
+}
+
 inline void put_integer(std::ostream &stream, const int v) {
     ASSERT(stream.good(), "Stream is not good");
     ASSERT(v < 0x10000, "Integer value is unexpectedly big");
@@ -1550,7 +1718,11 @@ std::ostream &operator<<(std::ostream &stream, const NIZKProof &p) {
     return stream;
 }
 
-NIZKProof::NIZKProof(std::istream &stream) : fixed(true) {
+NIZKProof::NIZKProof(std::istream &stream)
+    : preferZK(true), format(LegacyFormat), compressedPoints(true),
+    optimizedFpPlacement(false),
+    fpPreset(false),
+    fixed(true) {
     ASSERT(stream.good(), "Stream is not good");
     type = static_cast<CommitType>(stream.get());
     ASSERT(stream.good(), "Stream is not good");
@@ -1601,6 +1773,8 @@ NIZKProof::NIZKProof(std::istream &stream) : fixed(true) {
     additionalG2.resize(s = get_integer(stream));
     while (s-- > 0)
         readFromStream(stream, additionalG2[s].formula);
+    checkOrder = getCheckOrder();
+    getStatementHash();
 }
 
 std::istream &operator>>(std::istream &stream, NIZKProof &p) {
@@ -1609,36 +1783,105 @@ std::istream &operator>>(std::istream &stream, NIZKProof &p) {
     return stream;
 }
 
+/* Values of the additional variables and of the intermediate nodes
+ * evaluated by verifySolution, kept out of the proof so that concurrent
+ * calls do not interfere. Other variables and constants are never cached. */
+struct EvalCache {
+    std::vector<Fp> additionalFp;
+    std::vector<G1> additionalG1;
+    std::vector<G2> additionalG2;
+    std::unordered_map<const FpData*, Fp> fp;
+    std::unordered_map<const G1Data*, G1> g1;
+    std::unordered_map<const G2Data*, G2> g2;
+};
+
 bool NIZKProof::verifySolution(const ProofData &instantiation,
-                               const CRS &crs) const {
+                               const CRS &crs, bool randomized) const {
     if (!fixed)
         throw "Equations not fixed yet! (in NIZKProof::verifySolution)";
     if (!checkInstantiation(instantiation))
         return false;
-    for (const AdditionalFp &aFp : additionalFp)
-        aFp.value = real_eval(*aFp.formula, instantiation, crs);
-    for (const AdditionalG1 &aG1 : additionalG1)
-        aG1.value = real_eval(*aG1.formula, instantiation, crs);
-    for (const AdditionalG2 &aG2 : additionalG2)
-        aG2.value = real_eval(*aG2.formula, instantiation, crs);
+    EvalCache cache;
+    cache.additionalFp.reserve(additionalFp.size());
+    for (const AdditionalFp &aFp : additionalFp) {
+        cache.additionalFp.push_back(
+                    cached_eval(*aFp.formula, instantiation, crs, cache));
+    }
+    cache.additionalG1.reserve(additionalG1.size());
+    for (const AdditionalG1 &aG1 : additionalG1) {
+        cache.additionalG1.push_back(
+                    cached_eval(*aG1.formula, instantiation, crs, cache));
+    }
+    cache.additionalG2.reserve(additionalG2.size());
+    for (const AdditionalG2 &aG2 : additionalG2) {
+        cache.additionalG2.push_back(
+                    cached_eval(*aG2.formula, instantiation, crs, cache));
+    }
+    if (randomized) {
+        Fp sumFp;
+        std::vector<G1> diffG1;
+        std::vector<G2> diffG2;
+        std::vector<ShortScalar> coeffs(
+                    std::max(eqsG1.size(), eqsG2.size()));
+        GT rest;
+        std::vector< std::pair<G1,G2> > pairs, eqPairs;
+        for (const PairFp &p : eqsFp) {
+            sumFp += ShortScalar::getRand().toFp() *
+                    (cached_eval(*p.first, instantiation, crs, cache) -
+                     cached_eval(*p.second, instantiation, crs, cache));
+        }
+        for (const PairG1 &p : eqsG1) {
+            diffG1.push_back(
+                        cached_eval(*p.first, instantiation, crs, cache) -
+                        cached_eval(*p.second, instantiation, crs, cache));
+        }
+        for (const PairG2 &p : eqsG2) {
+            diffG2.push_back(
+                        cached_eval(*p.first, instantiation, crs, cache) -
+                        cached_eval(*p.second, instantiation, crs, cache));
+        }
+        ShortScalar::getRandMany(coeffs.data(), coeffs.size());
+        G1 sumG1 = G1::mulSum(diffG1.data(), coeffs.data(), diffG1.size());
+        ShortScalar::getRandMany(coeffs.data(), coeffs.size());
+        G2 sumG2 = G2::mulSum(diffG2.data(), coeffs.data(), diffG2.size());
+        for (const PairGT &p : eqsGT) {
+            ShortScalar c = ShortScalar::getRand();
+            GT eqRest;
+            eqPairs.clear();
+            gatherPairings(*p.first, instantiation, crs, false,
+                           eqPairs, eqRest, cache);
+            gatherPairings(*p.second, instantiation, crs, true,
+                           eqPairs, eqRest, cache);
+            for (const std::pair<G1,G2> &q : eqPairs)
+                pairs.push_back(std::pair<G1,G2>(q.first * c, q.second));
+            rest *= eqRest ^ c;
+        }
+        return sumFp.isNull() && sumG1.isNull() && sumG2.isNull() &&
+                (GT::pairing(pairs) * rest).isUnit();
+    }
     for (const PairFp &p : eqsFp) {
-        if (real_eval(*p.first, instantiation, crs) !=
-                real_eval(*p.second, instantiation, crs))
+        if (cached_eval(*p.first, instantiation, crs, cache) !=
+                cached_eval(*p.second, instantiation, crs, cache))
             return false;
     }
     for (const PairG1 &p : eqsG1) {
-        if (real_eval(*p.first, instantiation, crs) !=
-                real_eval(*p.second, instantiation, crs))
+        if (cached_eval(*p.first, instantiation, crs, cache) !=
+                cached_eval(*p.second, instantiation, crs, cache))
             return false;
     }
     for (const PairG2 &p : eqsG2) {
-        if (real_eval(*p.first, instantiation, crs) !=
-                real_eval(*p.second, instantiation, crs))
+        if (cached_eval(*p.first, instantiation, crs, cache) !=
+                cached_eval(*p.second, instantiation, crs, cache))
             return false;
     }
     for (const PairGT &p : eqsGT) {
-        if (real_eval(*p.first, instantiation, crs) !=
-                real_eval(*p.second, instantiation, crs))
+        std::vector< std::pair<G1,G2> > pairs;
+        GT rest;
+        gatherPairings(*p.first, instantiation, crs, false, pairs, rest,
+                       cache);
+        gatherPairings(*p.second, instantiation, crs, true, pairs, rest,
+                       cache);
+        if (!(GT::pairing(pairs) * rest).isUnit())
             return false;
     }
     return true;
@@ -1975,7 +2218,133 @@ void convToB(PiG2 &v, const CRS &crs) {
     //v.type = VALUE_B;
 }
 
-void NIZKProof::writeEqProof(std::ostream &stream, const void *leftp,
+/* Output with the same format as the std::ostream operators,
+ * but written directly into a (large enough) caller buffer. Without
+ * compression, group elements are written with their uncompressed
+ * (fixed length) encoding instead. */
+struct BufferWriter {
+    char *p;
+    bool compressed;
+    int lenFp, lenG1, lenG2;
+    inline BufferWriter(char *buf, bool compressed = true)
+        : p(buf), compressed(compressed), lenFp(Fp::getDataLen()),
+          lenG1(G1::getDataLen(compressed)),
+          lenG2(G2::getDataLen(compressed)) {}
+};
+
+inline BufferWriter &operator<<(BufferWriter &w, const Fp &el) {
+    el.getData(w.p);
+    w.p += w.lenFp;
+    return w;
+}
+
+inline BufferWriter &operator<<(BufferWriter &w, const G1 &el) {
+    el.getData(w.p, w.compressed);
+    w.p += ((w.compressed && el.isNull()) ? 1 : w.lenG1);
+    return w;
+}
+
+inline BufferWriter &operator<<(BufferWriter &w, const G2 &el) {
+    el.getData(w.p, w.compressed);
+    w.p += ((w.compressed && el.isNull()) ? 1 : w.lenG2);
+    return w;
+}
+
+inline BufferWriter &operator<<(BufferWriter &w, const B1 &el) {
+    return w << el._1 << el._2;
+}
+
+inline BufferWriter &operator<<(BufferWriter &w, const B2 &el) {
+    return w << el._1 << el._2;
+}
+
+size_t getEqProofSize(EqProofType t, bool compressed) {
+    size_t lenFp = Fp::getDataLen();
+    size_t lenB1 = G1::getDataLen(compressed) << 1;
+    size_t lenB2 = G2::getDataLen(compressed) << 1;
+    switch (t) {
+    case EQ_TYPE_PPE:
+        return (lenB1 + lenB2) << 1;
+    case EQ_TYPE_PEnc_G:
+    case EQ_TYPE_ME_H:
+        return (lenB1 << 1) + lenB2;
+    case EQ_TYPE_PConst_G:
+        return lenB1;
+    case EQ_TYPE_PEnc_H:
+    case EQ_TYPE_ME_G:
+        return lenB1 + (lenB2 << 1);
+    case EQ_TYPE_PConst_H:
+        return lenB2;
+    case EQ_TYPE_MEnc_G:
+    case EQ_TYPE_MEnc_H:
+    case EQ_TYPE_QE:
+        return lenB1 + lenB2;
+    case EQ_TYPE_MConst_G:
+        return lenB1 >> 1;
+    case EQ_TYPE_MConst_H:
+        return lenB2 >> 1;
+    case EQ_TYPE_MLin_G:
+    case EQ_TYPE_MLin_H:
+        return lenFp << 1;
+    case EQ_TYPE_QConst_G:
+    case EQ_TYPE_QConst_H:
+        return lenFp;
+    default:
+        ASSERT(false, "Unexpected equation type");
+        return 0;
+    }
+}
+
+/* Number of values in Fp, G1 and G2 (written in this order, see
+ * writeEqProof) in the proof of an equation */
+void getEqProofLayout(EqProofType t, int n[3]) {
+    n[0] = n[1] = n[2] = 0;
+    switch (t) {
+    case EQ_TYPE_PPE:
+        n[1] = n[2] = 4;
+        break;
+    case EQ_TYPE_PEnc_G:
+    case EQ_TYPE_ME_H:
+        n[1] = 4;
+        n[2] = 2;
+        break;
+    case EQ_TYPE_PConst_G:
+        n[1] = 2;
+        break;
+    case EQ_TYPE_PEnc_H:
+    case EQ_TYPE_ME_G:
+        n[1] = 2;
+        n[2] = 4;
+        break;
+    case EQ_TYPE_PConst_H:
+        n[2] = 2;
+        break;
+    case EQ_TYPE_MEnc_G:
+    case EQ_TYPE_MEnc_H:
+    case EQ_TYPE_QE:
+        n[1] = n[2] = 2;
+        break;
+    case EQ_TYPE_MConst_G:
+        n[1] = 1;
+        break;
+    case EQ_TYPE_MConst_H:
+        n[2] = 1;
+        break;
+    case EQ_TYPE_MLin_G:
+    case EQ_TYPE_MLin_H:
+        n[0] = 2;
+        break;
+    case EQ_TYPE_QConst_G:
+    case EQ_TYPE_QConst_H:
+        n[0] = 1;
+        break;
+    default:
+        ASSERT(false, "Unexpected equation type");
+    }
+}
+
+template <class T>
+void NIZKProof::writeEqProof(T &stream, const void *leftp,
                   const void *rightp, EqProofType expectedType,
                   const CRS &crs) const {
     const ProofEls &left = *reinterpret_cast<const ProofEls*>(leftp);
@@ -1994,17 +2363,10 @@ void NIZKProof::writeEqProof(std::ostream &stream, const void *leftp,
         convToB(result.p1_w, crs);
         convToB(result.p2_v, crs);
         convToB(result.p2_w, crs);
-        if (crs.type == CRS_TYPE_PRIVATE) {
-            result.p2_v.b2Value += (alpha + crs.i2 * beta) * crs.v2;
-            result.p2_w.b2Value += (gamma + crs.i2 * delta) * crs.v2;
-            result.p1_v.b1Value -= (alpha + crs.i1 * gamma) * crs.v1;
-            result.p1_w.b1Value -= (beta + crs.i1 * delta) * crs.v1;
-        } else {
-            result.p2_v.b2Value += alpha * crs.v2 + beta * crs.w2;
-            result.p2_w.b2Value += gamma * crs.v2 + delta * crs.w2;
-            result.p1_v.b1Value -= alpha * crs.v1 + gamma * crs.w1;
-            result.p1_w.b1Value -= beta * crs.v1 + delta * crs.w1;
-        }
+        result.p2_v.b2Value += crs.combine<B2>(alpha, beta);
+        result.p2_w.b2Value += crs.combine<B2>(gamma, delta);
+        result.p1_v.b1Value -= crs.combine<B1>(alpha, gamma);
+        result.p1_w.b1Value -= crs.combine<B1>(beta, delta);
         stream << result.p1_v.b1Value;
         stream << result.p1_w.b1Value;
         stream << result.p2_v.b2Value;
@@ -2019,11 +2381,7 @@ void NIZKProof::writeEqProof(std::ostream &stream, const void *leftp,
         convToB(result.p1_w, crs);
         convToB(result.p2_v, crs);
         ASSERT(result.p2_w.type == VALUE_NULL, "Unexpected type");
-        if (crs.type == CRS_TYPE_PRIVATE) {
-            result.p2_v.b2Value += (alpha + crs.i2 * beta) * crs.v2;
-        } else {
-            result.p2_v.b2Value += alpha * crs.v2 + beta * crs.w2;
-        }
+        result.p2_v.b2Value += crs.combine<B2>(alpha, beta);
         result.p1_v.b1Value -= alpha * crs.v1;
         result.p1_w.b1Value -= beta * crs.v1;
         stream << result.p1_v.b1Value;
@@ -2053,11 +2411,7 @@ void NIZKProof::writeEqProof(std::ostream &stream, const void *leftp,
         convToB(result.p2_w, crs);
         result.p2_v.b2Value += alpha * crs.v2;
         result.p2_w.b2Value += gamma * crs.v2;
-        if (crs.type == CRS_TYPE_PRIVATE) {
-            result.p1_v.b1Value -= (alpha + crs.i1 * gamma) * crs.v1;
-        } else {
-            result.p1_v.b1Value -= alpha * crs.v1 + gamma * crs.w1;
-        }
+        result.p1_v.b1Value -= crs.combine<B1>(alpha, gamma);
         stream << result.p1_v.b1Value;
         stream << result.p2_v.b2Value;
         stream << result.p2_w.b2Value;
@@ -2163,6 +2517,671 @@ void NIZKProof::writeProof(std::ostream &stream, const CRS &crs,
         throw "Equations not fixed yet! (in NIZKProof::writeProof)";
     if (!checkInstantiation(instantiation))
         throw "Wrong instantiation in NIZKProof::writeProof!";
+    if ((format == IndexedFormat) || !compressedPoints) {
+        /* The header depends on the offsets of the sections, and the
+         * stream operators only write compressed elements */
+        std::vector<char> buf(proofSize());
+        stream.write(buf.data(), writeProof(buf.data(), buf.size(), crs,
+                                            instantiation));
+        return;
+    }
+    writeProofTo(stream, crs, instantiation);
+}
+
+size_t NIZKProof::writeProof(char *buf, size_t len, const CRS &crs,
+                             const ProofData &instantiation) const {
+    if (!fixed)
+        throw "Equations not fixed yet! (in NIZKProof::writeProof)";
+    if (!checkInstantiation(instantiation))
+        throw "Wrong instantiation in NIZKProof::writeProof!";
+    if (len < proofSize())
+        throw "Buffer too small in NIZKProof::writeProof!";
+    if (format == IndexedFormat) {
+        BufferWriter writer(buf + getHeaderLen(), compressedPoints);
+        writeProofTo(writer, crs, instantiation);
+        return putHeader(buf, writer.p - (buf + getHeaderLen()));
+    }
+    BufferWriter writer(buf, compressedPoints);
+    writeProofTo(writer, crs, instantiation);
+    return static_cast<size_t>(writer.p - buf);
+}
+
+size_t NIZKProof::proofSize() const {
+    if (!fixed)
+        throw "Equations not fixed yet! (in NIZKProof::proofSize)";
+    return getProofSize(compressedPoints);
+}
+
+size_t NIZKProof::getProofSize(bool compressed) const {
+    size_t lenB1 = G1::getDataLen(compressed) << 1;
+    size_t lenB2 = G2::getDataLen(compressed) << 1;
+    size_t result = varsG1.size() * lenB1 + varsG2.size() * lenB2;
+    for (int i = varsFpInB1.size(); i-- > 0;)
+        result += (varsFpInB1[i] ? lenB1 : lenB2);
+    for (EqProofType t : tFp)
+        result += getEqProofSize(t, compressed);
+    for (EqProofType t : tG1)
+        result += getEqProofSize(t, compressed);
+    for (EqProofType t : tG2)
+        result += getEqProofSize(t, compressed);
+    for (EqProofType t : tGT)
+        result += getEqProofSize(t, compressed);
+    if (format == IndexedFormat)
+        result += getHeaderLen();
+    return result;
+}
+
+/* Structural cost estimation: the following mirrors writeProofTo (for the
+ * types of the intermediate values, see getProof, getLeft and getRight)
+ * and checkProofFrom (see calcExpr, calcLeft and calcRight), without
+ * doing any actual computation. */
+
+struct CommitCost {
+    CommitType type;
+    ValueType c;
+};
+
+struct PiCost {
+    /* p1_v, p1_w, p2_v, p2_w */
+    ValueType t[4];
+};
+
+const PiCost nullPi = {{VALUE_NULL, VALUE_NULL, VALUE_NULL, VALUE_NULL}};
+
+struct CostEstimator {
+    ProofCost &cost;
+    std::unordered_map<const void*, CommitCost> commits;
+    std::unordered_map<const void*, PiCost> proofEls;
+    /* Number of non-null components of the verifier's B1/B2 values */
+    std::unordered_map<const void*, int> components;
+    std::set<const void*> calculated;
+    inline CostEstimator(ProofCost &cost) : cost(cost) {}
+    inline int &mults(int slot) {
+        return (slot < 2) ? cost.proverMultsG1 : cost.proverMultsG2;
+    }
+    inline void mulPi(ValueType t, int slot) {
+        if (t == VALUE_G)
+            ++mults(slot);
+        else if (t == VALUE_B)
+            mults(slot) += 2;
+    }
+    ValueType addPi(ValueType a, ValueType b, int slot);
+    inline void addAllPi(PiCost &p, const PiCost &other) {
+        for (int i = 4; i--;)
+            p.t[i] = addPi(p.t[i], other.t[i], i);
+    }
+    void addCommit(const CommitCost &c1, const CommitCost &c2,
+                   CommitCost &cr, int slot);
+    PiCost scalarCombine(CommitCost c1, CommitCost c2);
+    void proofEq(const PiCost &left, const PiCost &right, EqProofType t);
+    void pairing(int left, int right);
+    void rndProofPart(EqProofType t);
+    const PiCost &proof(const FpData &d);
+    const PiCost &proof(const G1Data &d);
+    const PiCost &proof(const G2Data &d);
+    const PiCost &proof(const GTData &d);
+    const CommitCost &left(const FpData &d);
+    const CommitCost &left(const G1Data &d);
+    const CommitCost &right(const FpData &d);
+    const CommitCost &right(const G2Data &d);
+    void calc(const FpData &d);
+    void calc(const G1Data &d);
+    void calc(const G2Data &d);
+    void calc(const GTData &d);
+    /* Scalars are always full elements of B1 or B2 */
+    inline int calcLeft(const FpData &) { return 2; }
+    int calcLeft(const G1Data &d);
+    inline int calcRight(const FpData &) { return 2; }
+    int calcRight(const G2Data &d);
+};
+
+ValueType CostEstimator::addPi(ValueType a, ValueType b, int slot) {
+    if (a == VALUE_NULL) return b;
+    if (b == VALUE_NULL) return a;
+    if (a == b) return a;
+    /* Conversion of the scalar value with the unit element */
+    if ((a == VALUE_Fp) || (b == VALUE_Fp))
+        mults(slot) += 2;
+    return VALUE_B;
+}
+
+void CostEstimator::addCommit(const CommitCost &c1, const CommitCost &c2,
+                              CommitCost &cr, int slot) {
+    cr.type = ((c1.type < c2.type) ? c2.type : c1.type);
+    if (c1.c == c2.c) {
+        cr.c = c1.c;
+        return;
+    }
+    if ((c1.c == VALUE_Fp) || (c2.c == VALUE_Fp))
+        mults(slot) += 2;
+    cr.c = VALUE_B;
+}
+
+PiCost CostEstimator::scalarCombine(CommitCost c1, CommitCost c2) {
+    PiCost p = nullPi;
+    switch (c1.type) {
+    case COMMIT_PRIV:
+        mulPi(p.t[3] = c2.c, 3);
+    case COMMIT_ENC:
+        mulPi(p.t[2] = c2.c, 2);
+    case COMMIT_PUB:
+        break;
+    }
+    switch (c2.type) {
+    case COMMIT_PRIV:
+        mulPi(p.t[1] = c1.c, 1);
+    case COMMIT_ENC:
+        mulPi(p.t[0] = c1.c, 0);
+    case COMMIT_PUB:
+        break;
+    }
+    return p;
+}
+
+void CostEstimator::proofEq(const PiCost &left, const PiCost &right,
+                            EqProofType t) {
+    PiCost result;
+    for (int i = 4; i--;)
+        result.t[i] = addPi(left.t[i], right.t[i], i);
+    int converted = 0;
+    /* Each CRS::combine is one joint pass per coordinate */
+    switch (t) {
+    case EQ_TYPE_PPE:
+        converted = 15;
+        cost.proverMultsG1 += 4;
+        cost.proverMultsG2 += 4;
+        break;
+    case EQ_TYPE_PEnc_G:
+    case EQ_TYPE_ME_H:
+        converted = 7;
+        cost.proverMultsG1 += 4;
+        cost.proverMultsG2 += 2;
+        break;
+    case EQ_TYPE_PEnc_H:
+    case EQ_TYPE_ME_G:
+        converted = 13;
+        cost.proverMultsG1 += 2;
+        cost.proverMultsG2 += 4;
+        break;
+    case EQ_TYPE_MEnc_G:
+    case EQ_TYPE_MEnc_H:
+    case EQ_TYPE_QE:
+        converted = 5;
+        cost.proverMultsG1 += 2;
+        cost.proverMultsG2 += 2;
+        break;
+    default:
+        break;
+    }
+    for (int i = 4; i--;) {
+        if (((converted >> i) & 1) && (result.t[i] == VALUE_Fp))
+            mults(i) += 2;
+    }
+}
+
+void CostEstimator::pairing(int left, int right) {
+    cost.verifierPairings += left * right;
+    cost.verifierPairingProducts += left * right;
+}
+
+void CostEstimator::rndProofPart(EqProofType t) {
+    switch (t) {
+    case EQ_TYPE_PPE:
+        cost.verifierPairings += 16;
+        cost.verifierPairingProducts += 4;
+        break;
+    case EQ_TYPE_PEnc_G:
+    case EQ_TYPE_ME_H:
+    case EQ_TYPE_PEnc_H:
+    case EQ_TYPE_ME_G:
+        cost.verifierPairings += 12;
+        cost.verifierPairingProducts += 4;
+        break;
+    case EQ_TYPE_PConst_G:
+    case EQ_TYPE_PConst_H:
+        cost.verifierPairings += 4;
+        cost.verifierPairingProducts += 2;
+        break;
+    case EQ_TYPE_MEnc_G:
+    case EQ_TYPE_MEnc_H:
+    case EQ_TYPE_QE:
+        cost.verifierPairings += 8;
+        cost.verifierPairingProducts += 4;
+        break;
+    case EQ_TYPE_MConst_G:
+    case EQ_TYPE_MConst_H:
+        pairing(1, 2);
+        break;
+    case EQ_TYPE_MLin_G:
+    case EQ_TYPE_MLin_H:
+    case EQ_TYPE_QConst_G:
+    case EQ_TYPE_QConst_H:
+        pairing(2, 2);
+        break;
+    }
+}
+
+const PiCost &CostEstimator::proof(const FpData &d) {
+    auto it = proofEls.find(&d);
+    if (it != proofEls.end()) return it->second;
+    PiCost p = nullPi;
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        p = proof(*d.pair.first);
+        addAllPi(p, proof(*d.pair.second));
+        break;
+    case ELEMENT_SCALAR:
+        p = scalarCombine(left(*d.pair.first), right(*d.pair.second));
+        break;
+    default:
+        break;
+    }
+    return proofEls[&d] = p;
+}
+
+const PiCost &CostEstimator::proof(const G1Data &d) {
+    auto it = proofEls.find(&d);
+    if (it != proofEls.end()) return it->second;
+    PiCost p = nullPi;
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        p = proof(*d.pair.first);
+        addAllPi(p, proof(*d.pair.second));
+        break;
+    case ELEMENT_SCALAR:
+        p = scalarCombine(left(*d.scalar.second), right(*d.scalar.first));
+        break;
+    default:
+        break;
+    }
+    return proofEls[&d] = p;
+}
+
+const PiCost &CostEstimator::proof(const G2Data &d) {
+    auto it = proofEls.find(&d);
+    if (it != proofEls.end()) return it->second;
+    PiCost p = nullPi;
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        p = proof(*d.pair.first);
+        addAllPi(p, proof(*d.pair.second));
+        break;
+    case ELEMENT_SCALAR:
+        p = scalarCombine(left(*d.scalar.first), right(*d.scalar.second));
+        break;
+    default:
+        break;
+    }
+    return proofEls[&d] = p;
+}
+
+const PiCost &CostEstimator::proof(const GTData &d) {
+    auto it = proofEls.find(&d);
+    if (it != proofEls.end()) return it->second;
+    PiCost p = nullPi;
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        p = proof(*d.pair.first);
+        addAllPi(p, proof(*d.pair.second));
+        break;
+    case ELEMENT_PAIRING:
+        p = scalarCombine(left(*d.pring.first), right(*d.pring.second));
+        break;
+    default:
+        break;
+    }
+    return proofEls[&d] = p;
+}
+
+const CommitCost &CostEstimator::left(const FpData &d) {
+    auto it = commits.find(&d);
+    if (it != commits.end()) return it->second;
+    CommitCost c = {COMMIT_PUB, VALUE_Fp};
+    if (d.type == ELEMENT_PAIR) {
+        CommitCost c1 = left(*d.pair.first);
+        addCommit(c1, left(*d.pair.second), c, 0);
+    }
+    return commits[&d] = c;
+}
+
+const CommitCost &CostEstimator::left(const G1Data &d) {
+    auto it = commits.find(&d);
+    if (it != commits.end()) return it->second;
+    CommitCost c = {COMMIT_PUB, VALUE_G};
+    if (d.type == ELEMENT_PAIR) {
+        CommitCost c1 = left(*d.pair.first);
+        addCommit(c1, left(*d.pair.second), c, 0);
+    }
+    return commits[&d] = c;
+}
+
+const CommitCost &CostEstimator::right(const FpData &d) {
+    auto it = commits.find(&d);
+    if (it != commits.end()) return it->second;
+    CommitCost c = {COMMIT_PUB, VALUE_Fp};
+    if (d.type == ELEMENT_PAIR) {
+        CommitCost c1 = right(*d.pair.first);
+        addCommit(c1, right(*d.pair.second), c, 2);
+    }
+    return commits[&d] = c;
+}
+
+const CommitCost &CostEstimator::right(const G2Data &d) {
+    auto it = commits.find(&d);
+    if (it != commits.end()) return it->second;
+    CommitCost c = {COMMIT_PUB, VALUE_G};
+    if (d.type == ELEMENT_PAIR) {
+        CommitCost c1 = right(*d.pair.first);
+        addCommit(c1, right(*d.pair.second), c, 2);
+    }
+    return commits[&d] = c;
+}
+
+void CostEstimator::calc(const FpData &d) {
+    if (!calculated.insert(&d).second) return;
+    switch (d.type) {
+    case ELEMENT_CONST_VALUE:
+    case ELEMENT_BASE:
+        pairing(2, 2);
+        break;
+    case ELEMENT_PAIR:
+        calc(*d.pair.first);
+        calc(*d.pair.second);
+        break;
+    case ELEMENT_SCALAR:
+        pairing(calcLeft(*d.pair.first), calcRight(*d.pair.second));
+        break;
+    default:
+        break;
+    }
+}
+
+void CostEstimator::calc(const G1Data &d) {
+    if (!calculated.insert(&d).second) return;
+    switch (d.type) {
+    case ELEMENT_CONST_VALUE:
+    case ELEMENT_BASE:
+        pairing(1, 2);
+        break;
+    case ELEMENT_PAIR:
+        calc(*d.pair.first);
+        calc(*d.pair.second);
+        break;
+    case ELEMENT_SCALAR:
+        pairing(calcLeft(*d.scalar.second), calcRight(*d.scalar.first));
+        break;
+    default:
+        break;
+    }
+}
+
+void CostEstimator::calc(const G2Data &d) {
+    if (!calculated.insert(&d).second) return;
+    switch (d.type) {
+    case ELEMENT_CONST_VALUE:
+    case ELEMENT_BASE:
+        pairing(2, 1);
+        break;
+    case ELEMENT_PAIR:
+        calc(*d.pair.first);
+        calc(*d.pair.second);
+        break;
+    case ELEMENT_SCALAR:
+        pairing(calcLeft(*d.scalar.first), calcRight(*d.scalar.second));
+        break;
+    default:
+        break;
+    }
+}
+
+void CostEstimator::calc(const GTData &d) {
+    if (!calculated.insert(&d).second) return;
+    switch (d.type) {
+    case ELEMENT_BASE:
+        pairing(1, 1);
+        break;
+    case ELEMENT_PAIR:
+        calc(*d.pair.first);
+        calc(*d.pair.second);
+        break;
+    case ELEMENT_PAIRING:
+        pairing(calcLeft(*d.pring.first), calcRight(*d.pring.second));
+        break;
+    default:
+        break;
+    }
+}
+
+int CostEstimator::calcLeft(const G1Data &d) {
+    auto it = components.find(&d);
+    if (it != components.end()) return it->second;
+    int c = (d.type == ELEMENT_VARIABLE) ? 2 : 1;
+    if (d.type == ELEMENT_PAIR) {
+        c = calcLeft(*d.pair.first);
+        if (calcLeft(*d.pair.second) > c) c = 2;
+    }
+    return components[&d] = c;
+}
+
+int CostEstimator::calcRight(const G2Data &d) {
+    auto it = components.find(&d);
+    if (it != components.end()) return it->second;
+    int c = (d.type == ELEMENT_VARIABLE) ? 2 : 1;
+    if (d.type == ELEMENT_PAIR) {
+        c = calcRight(*d.pair.first);
+        if (calcRight(*d.pair.second) > c) c = 2;
+    }
+    return components[&d] = c;
+}
+
+/* Scalar multiplications done by real_eval on the formula of an
+ * additional variable */
+int formulaMults(const G1Data &d) {
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        return formulaMults(*d.pair.first) + formulaMults(*d.pair.second);
+    case ELEMENT_SCALAR:
+        return 1 + formulaMults(*d.scalar.second);
+    default:
+        return 0;
+    }
+}
+
+int formulaMults(const G2Data &d) {
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        return formulaMults(*d.pair.first) + formulaMults(*d.pair.second);
+    case ELEMENT_SCALAR:
+        return 1 + formulaMults(*d.scalar.second);
+    default:
+        return 0;
+    }
+}
+
+double CostWeights::getCost(const ProofCost &cost) const {
+    return prover * (cost.proverMultsG1 * multG1 +
+                     cost.proverMultsG2 * multG2) +
+            verifier * (cost.verifierPairings * pairing +
+                        cost.verifierPairingProducts * pairingProduct) +
+            cost.proofSize * proofByte;
+}
+
+CostWeights CostWeights::measure(int iterations) {
+    typedef std::chrono::steady_clock Clock;
+    CostWeights w;
+    if (iterations < 1) iterations = 1;
+    std::vector<Fp> k;
+    std::vector<G1> g1;
+    std::vector<G2> g2;
+    std::vector< std::pair<G1,G2> > pairs;
+    for (int i = 0; i < iterations; ++i) {
+        k.push_back(Fp::getRand());
+        g1.push_back(G1::getRand());
+        g2.push_back(G2::getRand());
+    }
+    for (int i = 0; i < 4; ++i)
+        pairs.push_back(std::pair<G1,G2>(g1[i % iterations],
+                                         g2[(i + 1) % iterations]));
+    G1 r1;
+    G2 r2;
+    GT rt;
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+        r1 += g1[i] * k[i];
+    Clock::time_point t1 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+        r2 += g2[i] * k[i];
+    Clock::time_point t2 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+        rt *= GT::pairing(g1[i], g2[i]);
+    Clock::time_point t3 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+        rt *= GT::pairing(pairs);
+    Clock::time_point t4 = Clock::now();
+    double single, product;
+    w.multG1 = std::chrono::duration<double,std::micro>(t1 - t0).count();
+    w.multG2 = std::chrono::duration<double,std::micro>(t2 - t1).count();
+    single = std::chrono::duration<double,std::micro>(t3 - t2).count();
+    product = std::chrono::duration<double,std::micro>(t4 - t3).count();
+    w.multG1 /= iterations;
+    w.multG2 /= iterations;
+    single /= iterations;
+    product /= iterations;
+    /* A product of 4 pairings costs 4 Miller loops
+     * but a single final exponentiation */
+    w.pairing = (product > single) ? (product - single) / 3 : 0;
+    w.pairingProduct = (single > w.pairing) ? single - w.pairing : 0;
+    w.proofByte = 0;
+    return w;
+}
+
+ProofCost NIZKProof::estimateCost(const CRS &crs) const {
+    if (!fixed)
+        throw "Equations not fixed yet! (in NIZKProof::estimateCost)";
+    (void) crs; // Reserved
+    return getCost();
+}
+
+ProofCost NIZKProof::getCost() const {
+    ASSERT(varsFp.size() == varsFpInB1.size(), "Array sizes do not match");
+    ProofCost cost = ProofCost();
+    cost.proofSize = proofSize();
+    CostEstimator e(cost);
+    /* Commitments (see writeProofTo) */
+    for (const AdditionalG1 &aG1 : additionalG1)
+        cost.proverMultsG1 += formulaMults(*aG1.formula);
+    for (const AdditionalG2 &aG2 : additionalG2)
+        cost.proverMultsG2 += formulaMults(*aG2.formula);
+    /* Each commitment is one joint pass per coordinate
+     * (see B1::commitMany and B2::commitMany) */
+    for (int j = varsFp.size(); j-- > 0;) {
+        if (varsFpInB1[j]) {
+            ++cost.commitmentsB1;
+            cost.proverMultsG1 += 2;
+            e.commits[varsFp[j].get()] = {COMMIT_ENC, VALUE_Fp};
+        } else {
+            ++cost.commitmentsB2;
+            cost.proverMultsG2 += 2;
+            e.commits[varsFp[j].get()] = {COMMIT_ENC, VALUE_B};
+        }
+    }
+    for (int j = varsG1.size(); j-- > 0;) {
+        ++cost.commitmentsB1;
+        cost.proverMultsG1 += 2;
+        if ((type == AllEncrypted) ||
+                ((type == SelectedEncryption) && sEnc[INDEX_TYPE_G1][j])) {
+            ++cost.encryptedG1;
+            e.commits[varsG1[j].get()] = {COMMIT_ENC, VALUE_G};
+        } else {
+            e.commits[varsG1[j].get()] = {COMMIT_PRIV, VALUE_G};
+        }
+    }
+    for (int j = varsG2.size(); j-- > 0;) {
+        ++cost.commitmentsB2;
+        cost.proverMultsG2 += 2;
+        if ((type == AllEncrypted) ||
+                ((type == SelectedEncryption) && sEnc[INDEX_TYPE_G2][j])) {
+            ++cost.encryptedG2;
+            e.commits[varsG2[j].get()] = {COMMIT_ENC, VALUE_G};
+        } else {
+            e.commits[varsG2[j].get()] = {COMMIT_PRIV, VALUE_G};
+        }
+    }
+    /* Equation proofs and their verification */
+    for (int i = eqsFp.size(); i-- > 0;) {
+        e.proofEq(e.proof(*eqsFp[i].first), e.proof(*eqsFp[i].second),
+                  tFp[i]);
+        e.rndProofPart(tFp[i]);
+        e.calc(*eqsFp[i].first);
+        e.calc(*eqsFp[i].second);
+    }
+    for (int i = eqsG1.size(); i-- > 0;) {
+        e.proofEq(e.proof(*eqsG1[i].first), e.proof(*eqsG1[i].second),
+                  tG1[i]);
+        e.rndProofPart(tG1[i]);
+        e.calc(*eqsG1[i].first);
+        e.calc(*eqsG1[i].second);
+    }
+    for (int i = eqsG2.size(); i-- > 0;) {
+        e.proofEq(e.proof(*eqsG2[i].first), e.proof(*eqsG2[i].second),
+                  tG2[i]);
+        e.rndProofPart(tG2[i]);
+        e.calc(*eqsG2[i].first);
+        e.calc(*eqsG2[i].second);
+    }
+    for (int i = eqsGT.size(); i-- > 0;) {
+        e.proofEq(e.proof(*eqsGT[i].first), e.proof(*eqsGT[i].second),
+                  tGT[i]);
+        e.rndProofPart(tGT[i]);
+        e.calc(*eqsGT[i].first);
+        e.calc(*eqsGT[i].second);
+    }
+    return cost;
+}
+
+/* Verification cost of a single equation (see checkProofFrom) */
+template <typename T>
+double getCheckCost(const CostWeights &weights, const T &left,
+                    const T &right, EqProofType t) {
+    ProofCost cost = ProofCost();
+    CostEstimator e(cost);
+    e.rndProofPart(t);
+    e.calc(left);
+    e.calc(right);
+    return weights.pairing * cost.verifierPairings +
+            weights.pairingProduct * cost.verifierPairingProducts;
+}
+
+std::vector<int> NIZKProof::getCheckOrder() const {
+    /* Equations are numbered in the order of their proofs */
+    std::vector< std::pair<double,int> > costs;
+    for (int i = eqsFp.size(); i-- > 0;) {
+        costs.push_back(std::pair<double,int>(getCheckCost(weights,
+                *eqsFp[i].first, *eqsFp[i].second, tFp[i]), costs.size()));
+    }
+    for (int i = eqsG1.size(); i-- > 0;) {
+        costs.push_back(std::pair<double,int>(getCheckCost(weights,
+                *eqsG1[i].first, *eqsG1[i].second, tG1[i]), costs.size()));
+    }
+    for (int i = eqsG2.size(); i-- > 0;) {
+        costs.push_back(std::pair<double,int>(getCheckCost(weights,
+                *eqsG2[i].first, *eqsG2[i].second, tG2[i]), costs.size()));
+    }
+    for (int i = eqsGT.size(); i-- > 0;) {
+        costs.push_back(std::pair<double,int>(getCheckCost(weights,
+                *eqsGT[i].first, *eqsGT[i].second, tGT[i]), costs.size()));
+    }
+    std::stable_sort(costs.begin(), costs.end());
+    std::vector<int> order;
+    order.reserve(costs.size());
+    for (const std::pair<double,int> &c : costs)
+        order.push_back(c.second);
+    return order;
+}
+
+template <class T>
+void NIZKProof::writeProofTo(T &stream, const CRS &crs,
+                             const ProofData &instantiation) const {
     for (const AdditionalFp &aFp : additionalFp)
         aFp.value = real_eval(*aFp.formula, instantiation, crs);
     for (const AdditionalG1 &aG1 : additionalG1)
@@ -2173,6 +3192,12 @@ void NIZKProof::writeProof(std::ostream &stream, const CRS &crs,
     ASSERT(cstsFp.size() == cstsFpInB1.size(), "Array sizes do not match");
     G1Commit c1;
     G2Commit c2;
+    /* The commitments are computed in batches (see B1::commitMany and
+     * B2::commitMany), and then written in the order of the variables */
+    std::vector<Fp> fp1, rnd1, fp2, rnd2, rnd3;
+    std::vector<B1> b1;
+    std::vector<B2> b2;
+    std::vector<G2Commit*> commits2;
     int j = varsFp.size(), i = additionalFp.size();
     c1.type = COMMIT_ENC;
     c1.c.type = VALUE_Fp;
@@ -2183,12 +3208,14 @@ void NIZKProof::writeProof(std::ostream &stream, const CRS &crs,
             c1.r = Fp::getRand();
             c1.c.fpValue = additionalFp[i].value;
             varsFp[j]->d = reinterpret_cast<void*>(new G1Commit(c1));
-            stream << B1::commit(c1.c.fpValue, c1.r, crs);
+            fp1.push_back(c1.c.fpValue);
+            rnd1.push_back(c1.r);
         } else {
             c2.r = Fp::getRand();
-            c2.c.b2Value = B2::commit(additionalFp[i].value, c2.r, crs);
-            varsFp[j]->d = reinterpret_cast<void*>(new G2Commit(c2));
-            stream << c2.c.b2Value;
+            commits2.push_back(new G2Commit(c2));
+            varsFp[j]->d = reinterpret_cast<void*>(commits2.back());
+            fp2.push_back(additionalFp[i].value);
+            rnd2.push_back(c2.r);
         }
     }
     while (j-- > 0) {
@@ -2196,78 +3223,86 @@ void NIZKProof::writeProof(std::ostream &stream, const CRS &crs,
             c1.r = Fp::getRand();
             c1.c.fpValue = instantiation.privFp[j];
             varsFp[j]->d = reinterpret_cast<void*>(new G1Commit(c1));
-            stream << B1::commit(c1.c.fpValue, c1.r, crs);
+            fp1.push_back(c1.c.fpValue);
+            rnd1.push_back(c1.r);
         } else {
             c2.r = Fp::getRand();
-            c2.c.b2Value = B2::commit(instantiation.privFp[j], c2.r, crs);
-            varsFp[j]->d = reinterpret_cast<void*>(new G2Commit(c2));
-            stream << c2.c.b2Value;
+            commits2.push_back(new G2Commit(c2));
+            varsFp[j]->d = reinterpret_cast<void*>(commits2.back());
+            fp2.push_back(instantiation.privFp[j]);
+            rnd2.push_back(c2.r);
+        }
+    }
+    b1.resize(fp1.size());
+    b2.resize(fp2.size());
+    B1::commitMany(fp1.data(), rnd1.data(), fp1.size(), crs, b1.data());
+    B2::commitMany(fp2.data(), rnd2.data(), fp2.size(), crs, b2.data());
+    {
+        size_t k1 = 0, k2 = 0;
+        for (j = varsFp.size(); j-- > 0;) {
+            if (varsFpInB1[j]) {
+                stream << b1[k1++];
+            } else {
+                commits2[k2]->c.b2Value = b2[k2];
+                stream << b2[k2++];
+            }
         }
     }
+    rnd1.clear();
+    rnd2.clear();
+    b1.clear();
+    b2.clear();
+    commits2.clear();
     j = varsG1.size();
     i = additionalG1.size();
     c1.c.type = VALUE_G;
-    while (i-- > 0) {
-        --j;
-        c1.r = Fp::getRand();
-        c1.c.b1Value._2 = additionalG1[i].value;
-        if ((type == AllEncrypted) ||
-                ((type == SelectedEncryption) && sEnc[INDEX_TYPE_G1][j])) {
-            c1.type = COMMIT_ENC;
-            stream << B1::commit(c1.c.b1Value, c1.r, crs);
-        } else {
-            c1.type = COMMIT_PRIV;
-            c1.s = Fp::getRand();
-            stream << B1::commit(c1.c.b1Value, c1.r, c1.s, crs);
-        }
-        varsG1[j]->d = reinterpret_cast<void*>(new G1Commit(c1));
-    }
     while (j-- > 0) {
         c1.r = Fp::getRand();
-        c1.c.b1Value._2 = instantiation.privG1[j];
+        c1.c.b1Value._2 = (i > 0) ? additionalG1[--i].value
+                                  : instantiation.privG1[j];
         if ((type == AllEncrypted) ||
                 ((type == SelectedEncryption) && sEnc[INDEX_TYPE_G1][j])) {
             c1.type = COMMIT_ENC;
-            stream << B1::commit(c1.c.b1Value, c1.r, crs);
-        } else {
-            c1.type = COMMIT_PRIV;
-            c1.s = Fp::getRand();
-            stream << B1::commit(c1.c.b1Value, c1.r, c1.s, crs);
-        }
-        varsG1[j]->d = reinterpret_cast<void*>(new G1Commit(c1));
-    }
-    j = varsG2.size();
-    i = additionalG2.size();
-    while (i-- > 0) {
-        --j;
-        c2.r = Fp::getRand();
-        if ((type == AllEncrypted) ||
-                ((type == SelectedEncryption) && sEnc[INDEX_TYPE_G2][j])) {
-            c2.type = COMMIT_ENC;
-            c2.c.b2Value = B2::commit(additionalG2[i].value, c2.r, crs);
+            rnd3.push_back(Fp());
         } else {
-            c2.type = COMMIT_PRIV;
-            c2.s = Fp::getRand();
-            c2.c.b2Value = B2::commit(additionalG2[i].value, c2.r, c2.s, crs);
+            c1.type = COMMIT_PRIV;
+            c1.s = Fp::getRand();
+            rnd3.push_back(c1.s);
         }
-        stream << c2.c.b2Value;
-        varsG2[j]->d = reinterpret_cast<void*>(new G2Commit(c2));
-    }
+        varsG1[j]->d = reinterpret_cast<void*>(new G1Commit(c1));
+        b1.push_back(c1.c.b1Value);
+        rnd1.push_back(c1.r);
+    }
+    B1::commitMany(b1.data(), rnd1.data(), rnd3.data(), b1.size(), crs,
+                   b1.data());
+    for (const B1 &commit : b1)
+        stream << commit;
+    rnd3.clear();
+    j = varsG2.size();
+    i = additionalG2.size();
     while (j-- > 0) {
         c2.r = Fp::getRand();
+        c2.c.b2Value = B2((i > 0) ? additionalG2[--i].value
+                                  : instantiation.privG2[j]);
         if ((type == AllEncrypted) ||
                 ((type == SelectedEncryption) && sEnc[INDEX_TYPE_G2][j])) {
             c2.type = COMMIT_ENC;
-            c2.c.b2Value = B2::commit(instantiation.privG2[j],
-                    c2.r, crs);
+            rnd3.push_back(Fp());
         } else {
             c2.type = COMMIT_PRIV;
             c2.s = Fp::getRand();
-            c2.c.b2Value = B2::commit(instantiation.privG2[j],
-                    c2.r, c2.s, crs);
+            rnd3.push_back(c2.s);
         }
-        stream << c2.c.b2Value;
-        varsG2[j]->d = reinterpret_cast<void*>(new G2Commit(c2));
+        commits2.push_back(new G2Commit(c2));
+        varsG2[j]->d = reinterpret_cast<void*>(commits2.back());
+        b2.push_back(c2.c.b2Value);
+        rnd2.push_back(c2.r);
+    }
+    B2::commitMany(b2.data(), rnd2.data(), rnd3.data(), b2.size(), crs,
+                   b2.data());
+    for (size_t k = 0; k < b2.size(); ++k) {
+        commits2[k]->c.b2Value = b2[k];
+        stream << b2[k];
     }
     c2.c.b2Value._1.clear();
     c1.type = COMMIT_PUB;
@@ -2508,7 +3543,9 @@ void NIZKProof::getIndexes(std::shared_ptr<GTData> &d) {
     }
 }
 
-void NIZKProof::checkoutAsFp(std::shared_ptr<FpData> &d) {
+void NIZKProof::checkoutAsFp(std::shared_ptr<FpData> &dp) {
+    /* dp may be moved when new equations are appended */
+    FpData *d = dp.get();
     switch (d->type) {
     case ELEMENT_CONST_VALUE:
         break;
@@ -2517,6 +3554,13 @@ void NIZKProof::checkoutAsFp(std::shared_ptr<FpData> &d) {
         checkoutAsFp(d->pair.second);
         break;
     case ELEMENT_SCALAR:
+        /* With a preset placement, the product is oriented so that
+         * the least commitments need to be duplicated */
+        if (fpPreset && ((getMismatch(*d->pair.first, true) +
+                          getMismatch(*d->pair.second, false)) >
+                         (getMismatch(*d->pair.first, false) +
+                          getMismatch(*d->pair.second, true))))
+            std::swap(d->pair.first, d->pair.second);
         checkoutLeft(d->pair.first);
         checkoutRight(d->pair.second);
         break;
@@ -2527,7 +3571,28 @@ void NIZKProof::checkoutAsFp(std::shared_ptr<FpData> &d) {
     }
 }
 
-void NIZKProof::checkoutAsG1(std::shared_ptr<G1Data> &d) {
+/* Mismatch of a constant on the wrong side (see getMismatch): constants
+ * cannot be duplicated, so that a single one outweighs any number of
+ * variable commitments to duplicate */
+#define CONSTANT_MISMATCH 0x10000
+
+int NIZKProof::getMismatch(const FpData &d, bool inB1) const {
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        return (d.d && (varsFpInB1[d.index] != inB1)) ? 1 : 0;
+    case ELEMENT_CONST_INDEX:
+        return (d.d && (cstsFpInB1[d.index] != inB1)) ? CONSTANT_MISMATCH : 0;
+    case ELEMENT_PAIR:
+        return getMismatch(*d.pair.first, inB1) +
+                getMismatch(*d.pair.second, inB1);
+    default:
+        /* Products are replaced with new variables on the right side */
+        return 0;
+    }
+}
+
+void NIZKProof::checkoutAsG1(std::shared_ptr<G1Data> &dp) {
+    G1Data *d = dp.get();
     switch (d->type) {
     case ELEMENT_CONST_VALUE:
         break;
@@ -2546,7 +3611,8 @@ void NIZKProof::checkoutAsG1(std::shared_ptr<G1Data> &d) {
     }
 }
 
-void NIZKProof::checkoutAsG2(std::shared_ptr<G2Data> &d) {
+void NIZKProof::checkoutAsG2(std::shared_ptr<G2Data> &dp) {
+    G2Data *d = dp.get();
     switch (d->type) {
     case ELEMENT_CONST_VALUE:
         break;
@@ -2565,7 +3631,8 @@ void NIZKProof::checkoutAsG2(std::shared_ptr<G2Data> &d) {
     }
 }
 
-void NIZKProof::checkoutAsGT(std::shared_ptr<GTData> &d) {
+void NIZKProof::checkoutAsGT(std::shared_ptr<GTData> &dp) {
+    GTData *d = dp.get();
     switch (d->type) {
     case ELEMENT_CONST_INDEX:
     case ELEMENT_CONST_VALUE:
@@ -3049,6 +4116,127 @@ GT NIZKProof::real_eval(const GTData &d, const ProofData &instantiation,
     }
 }
 
+Fp NIZKProof::cached_eval(const FpData &d, const ProofData &instantiation,
+                          const CRS &crs, EvalCache &cache) const {
+    auto it = cache.fp.find(&d);
+    if (it != cache.fp.end()) return it->second;
+    Fp value;
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        if (static_cast<size_t>(d.index) >= instantiation.privFp.size())
+            return cache.additionalFp[d.index - instantiation.privFp.size()];
+        return instantiation.privFp[d.index];
+    case ELEMENT_CONST_INDEX:
+    case ELEMENT_CONST_VALUE:
+    case ELEMENT_BASE:
+        return real_eval(d, instantiation, crs);
+    case ELEMENT_PAIR:
+        value = cached_eval(*d.pair.first, instantiation, crs, cache) +
+                cached_eval(*d.pair.second, instantiation, crs, cache);
+        break;
+    case ELEMENT_SCALAR:
+        value = cached_eval(*d.pair.first, instantiation, crs, cache) *
+                cached_eval(*d.pair.second, instantiation, crs, cache);
+        break;
+    default:
+        ASSERT(false, "Unexpected data type");
+        return Fp();
+    }
+    cache.fp[&d] = value;
+    return value;
+}
+
+G1 NIZKProof::cached_eval(const G1Data &d, const ProofData &instantiation,
+                          const CRS &crs, EvalCache &cache) const {
+    auto it = cache.g1.find(&d);
+    if (it != cache.g1.end()) return it->second;
+    G1 value;
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        if (static_cast<size_t>(d.index) >= instantiation.privG1.size())
+            return cache.additionalG1[d.index - instantiation.privG1.size()];
+        return instantiation.privG1[d.index];
+    case ELEMENT_CONST_INDEX:
+    case ELEMENT_CONST_VALUE:
+    case ELEMENT_BASE:
+        return real_eval(d, instantiation, crs);
+    case ELEMENT_PAIR:
+        value = cached_eval(*d.pair.first, instantiation, crs, cache) +
+                cached_eval(*d.pair.second, instantiation, crs, cache);
+        break;
+    case ELEMENT_SCALAR:
+        value = cached_eval(*d.scalar.first, instantiation, crs, cache) *
+                cached_eval(*d.scalar.second, instantiation, crs, cache);
+        break;
+    default:
+        ASSERT(false, "Unexpected data type");
+        return G1();
+    }
+    cache.g1[&d] = value;
+    return value;
+}
+
+G2 NIZKProof::cached_eval(const G2Data &d, const ProofData &instantiation,
+                          const CRS &crs, EvalCache &cache) const {
+    auto it = cache.g2.find(&d);
+    if (it != cache.g2.end()) return it->second;
+    G2 value;
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        if (static_cast<size_t>(d.index) >= instantiation.privG2.size())
+            return cache.additionalG2[d.index - instantiation.privG2.size()];
+        return instantiation.privG2[d.index];
+    case ELEMENT_CONST_INDEX:
+    case ELEMENT_CONST_VALUE:
+    case ELEMENT_BASE:
+        return real_eval(d, instantiation, crs);
+    case ELEMENT_PAIR:
+        value = cached_eval(*d.pair.first, instantiation, crs, cache) +
+                cached_eval(*d.pair.second, instantiation, crs, cache);
+        break;
+    case ELEMENT_SCALAR:
+        value = cached_eval(*d.scalar.first, instantiation, crs, cache) *
+                cached_eval(*d.scalar.second, instantiation, crs, cache);
+        break;
+    default:
+        ASSERT(false, "Unexpected data type");
+        return G2();
+    }
+    cache.g2[&d] = value;
+    return value;
+}
+
+void NIZKProof::gatherPairings(const GTData &d,
+                               const ProofData &instantiation,
+                               const CRS &crs, bool inverse,
+                               std::vector< std::pair<G1,G2> > &pairs,
+                               GT &rest, EvalCache &cache) const {
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        gatherPairings(*d.pair.first, instantiation, crs, inverse,
+                       pairs, rest, cache);
+        gatherPairings(*d.pair.second, instantiation, crs, inverse,
+                       pairs, rest, cache);
+        break;
+    case ELEMENT_PAIRING:
+        if (inverse) {
+            pairs.push_back(std::pair<G1,G2>(
+                    -cached_eval(*d.pring.first, instantiation, crs, cache),
+                    cached_eval(*d.pring.second, instantiation, crs, cache)));
+        } else {
+            pairs.push_back(std::pair<G1,G2>(
+                    cached_eval(*d.pring.first, instantiation, crs, cache),
+                    cached_eval(*d.pring.second, instantiation, crs, cache)));
+        }
+        break;
+    default:
+        if (inverse)
+            rest /= real_eval(d, instantiation, crs);
+        else
+            rest *= real_eval(d, instantiation, crs);
+    }
+}
+
 void scalarCombine(const G1Commit &c1, const G2Commit &c2, ProofEls &p) {
     p.p2_v.type = VALUE_NULL;
     p.p2_w.type = VALUE_NULL;
@@ -3843,7 +5031,389 @@ void removeLeftCalc(const G1Data &d);
 void removeRightCalc(const FpData &d);
 void removeRightCalc(const G2Data &d);
 
-BT NIZKProof::getRndProofPart(std::istream &stream, EqProofType t,
+/* Input with the same format as the std::istream operators, but read
+ * directly from a caller buffer; any out-of-bounds or malformed element
+ * sets the fail flag instead of being decoded. Without compression,
+ * group elements are read with their uncompressed encoding (see
+ * BufferWriter). */
+struct BufferReader {
+    const char *p, *end;
+    bool fail, compressed;
+    int lenFp, lenG1, lenG2;
+    inline BufferReader(const char *data, size_t len, bool compressed = true)
+        : p(data), end(data + len), fail(false), compressed(compressed),
+          lenFp(Fp::getDataLen()), lenG1(G1::getDataLen(compressed)),
+          lenG2(G2::getDataLen(compressed)) {}
+    inline bool take(int len);
+    inline int elementLen(int len) const;
+};
+
+inline bool BufferReader::take(int len) {
+    if (fail) return false;
+    if (!compressed) {
+        if (end - p < len) {
+            fail = true;
+            return false;
+        }
+        return true;
+    }
+    if (p == end) {
+        fail = true;
+        return false;
+    }
+    if (*p == NULL_ELEMENT_BYTE_VALUE)
+        return true;
+    if (((*p != 0) && (*p != 1)) || (end - p < len)) {
+        fail = true;
+        return false;
+    }
+    return true;
+}
+
+/* Length of the element at p, after a successful take(len) */
+inline int BufferReader::elementLen(int len) const {
+    return (compressed && (*p == NULL_ELEMENT_BYTE_VALUE)) ? 1 : len;
+}
+
+/* Checks that data is the uncompressed encoding of the null element of G,
+ * since the data of invalid points is also decoded as null elements */
+template <class G>
+bool isNullData(const char *data, int len) {
+    std::string null(len, '\0');
+    G().getData(&null[0], false);
+    return !memcmp(data, null.data(), len);
+}
+
+inline BufferReader &operator>>(BufferReader &r, Fp &el) {
+    if (r.fail || (r.end - r.p < r.lenFp)) {
+        r.fail = true;
+        return r;
+    }
+    el = Fp::getValue(r.p);
+    r.p += r.lenFp;
+    return r;
+}
+
+inline BufferReader &operator>>(BufferReader &r, G1 &el) {
+    if (!r.take(r.lenG1)) return r;
+    el = G1::getValue(r.p, r.compressed);
+    if ((!r.compressed) && el.isNull() && !isNullData<G1>(r.p, r.lenG1)) {
+        r.fail = true;
+        return r;
+    }
+    r.p += r.elementLen(r.lenG1);
+    return r;
+}
+
+inline BufferReader &operator>>(BufferReader &r, G2 &el) {
+    if (!r.take(r.lenG2)) return r;
+    el = G2::getValue(r.p, r.compressed);
+    if ((!r.compressed) && el.isNull() && !isNullData<G2>(r.p, r.lenG2)) {
+        r.fail = true;
+        return r;
+    }
+    r.p += r.elementLen(r.lenG2);
+    return r;
+}
+
+inline BufferReader &operator>>(BufferReader &r, B1 &el) {
+    return r >> el._1 >> el._2;
+}
+
+inline BufferReader &operator>>(BufferReader &r, B2 &el) {
+    return r >> el._1 >> el._2;
+}
+
+inline bool readFailed(const std::istream &stream) {
+    return stream.fail();
+}
+
+inline bool readFailed(const BufferReader &r) {
+    return r.fail;
+}
+
+inline bool isCompressed(const std::istream &stream) {
+    (void) stream;
+    return true;
+}
+
+inline bool isCompressed(const BufferReader &r) {
+    return r.compressed;
+}
+
+/* Copies n raw compressed group elements at the end of data, without
+ * decoding them. */
+void readElements(std::istream &stream, int n, int len, std::string &data) {
+    while (n-- > 0) {
+        char lsb;
+        if (!stream.read(&lsb, 1)) return;
+        data.push_back(lsb);
+        if (lsb == NULL_ELEMENT_BYTE_VALUE) continue;
+        if ((lsb != 0) && (lsb != 1)) {
+            stream.setstate(std::ios::failbit);
+            return;
+        }
+        size_t pos = data.size();
+        data.resize(pos + len - 1);
+        stream.read(&data[pos], len - 1);
+    }
+}
+
+/* Copies the raw proof of an equation at the end of data, without
+ * decoding its elements, so that it can be checked later on. */
+void readEqProof(std::istream &stream, EqProofType t, std::string &data) {
+    int n[3];
+    getEqProofLayout(t, n);
+    size_t pos = data.size();
+    data.resize(pos + n[0] * Fp::getDataLen());
+    stream.read(&data[pos], n[0] * Fp::getDataLen());
+    readElements(stream, n[1], G1::getDataLen(true), data);
+    readElements(stream, n[2], G2::getDataLen(true), data);
+}
+
+inline void skipElements(BufferReader &r, int n, int len) {
+    while (n-- > 0) {
+        if (!r.take(len)) return;
+        r.p += r.elementLen(len);
+    }
+}
+
+void skipEqProof(BufferReader &r, EqProofType t) {
+    int n[3];
+    getEqProofLayout(t, n);
+    if (r.fail || (r.end - r.p < n[0] * r.lenFp)) {
+        r.fail = true;
+        return;
+    }
+    r.p += n[0] * r.lenFp;
+    skipElements(r, n[1], r.lenG1);
+    skipElements(r, n[2], r.lenG2);
+}
+
+void readEqProof(BufferReader &r, EqProofType t, std::string &data) {
+    const char *start = r.p;
+    skipEqProof(r, t);
+    if (!r.fail)
+        data.append(start, r.p - start);
+}
+
+void readElements(BufferReader &r, int n, int len, std::string &data) {
+    const char *start = r.p;
+    skipElements(r, n, len);
+    if (!r.fail)
+        data.append(start, r.p - start);
+}
+
+/* Raw commitments of a proof being checked. They are only decoded (and
+ * then cached in the d field of the variable) when an equation using
+ * them is about to be checked, so that a proof rejected early does not
+ * pay for the decompression of the points it never inspected. */
+struct RawCommitments {
+    const char *end;
+    bool compressed;
+    std::vector<const char*> fp, g1, g2;
+    const std::vector<bool> *fpInB1;
+};
+
+template <typename T>
+bool decodeCommitment(void *&d, const char *p, const RawCommitments &raw) {
+    BufferReader reader(p, raw.end - p, raw.compressed);
+    T value;
+    reader >> value;
+    if (reader.fail) return false;
+    d = reinterpret_cast<void*>(new T(value));
+    return true;
+}
+
+bool loadCommitments(const FpData &d, const RawCommitments &raw);
+bool loadCommitments(const G1Data &d, const RawCommitments &raw);
+bool loadCommitments(const G2Data &d, const RawCommitments &raw);
+
+/* Nodes with a calculation already cached only depend on commitments
+ * that have been loaded already. */
+bool loadCommitments(const FpData &d, const RawCommitments &raw) {
+    if (d.d) return true;
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        if ((*raw.fpInB1)[d.index])
+            return decodeCommitment<B1>(d.d, raw.fp[d.index], raw);
+        return decodeCommitment<B2>(d.d, raw.fp[d.index], raw);
+    case ELEMENT_PAIR:
+    case ELEMENT_SCALAR:
+        return loadCommitments(*d.pair.first, raw) &&
+                loadCommitments(*d.pair.second, raw);
+    default:
+        return true;
+    }
+}
+
+bool loadCommitments(const G1Data &d, const RawCommitments &raw) {
+    if (d.d) return true;
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        return decodeCommitment<B1>(d.d, raw.g1[d.index], raw);
+    case ELEMENT_PAIR:
+        return loadCommitments(*d.pair.first, raw) &&
+                loadCommitments(*d.pair.second, raw);
+    case ELEMENT_SCALAR:
+        return loadCommitments(*d.scalar.first, raw) &&
+                loadCommitments(*d.scalar.second, raw);
+    default:
+        return true;
+    }
+}
+
+bool loadCommitments(const G2Data &d, const RawCommitments &raw) {
+    if (d.d) return true;
+    switch (d.type) {
+    case ELEMENT_VARIABLE:
+        return decodeCommitment<B2>(d.d, raw.g2[d.index], raw);
+    case ELEMENT_PAIR:
+        return loadCommitments(*d.pair.first, raw) &&
+                loadCommitments(*d.pair.second, raw);
+    case ELEMENT_SCALAR:
+        return loadCommitments(*d.scalar.first, raw) &&
+                loadCommitments(*d.scalar.second, raw);
+    default:
+        return true;
+    }
+}
+
+bool loadCommitments(const GTData &d, const RawCommitments &raw) {
+    if (d.d) return true;
+    switch (d.type) {
+    case ELEMENT_PAIR:
+        return loadCommitments(*d.pair.first, raw) &&
+                loadCommitments(*d.pair.second, raw);
+    case ELEMENT_PAIRING:
+        return loadCommitments(*d.pring.first, raw) &&
+                loadCommitments(*d.pring.second, raw);
+    default:
+        return true;
+    }
+}
+
+/* Header of the IndexedFormat (integers are big endian):
+ * - 2 bytes: magic value "GS";
+ * - 1 byte: format version;
+ * - 1 byte: flags (PROOF_FLAG_UNCOMPRESSED if the group elements are
+ *   not compressed, 0 otherwise);
+ * - getHashLen() bytes: hash of the system of equations;
+ * - 4 bytes: number n of sections, that is the commitments and then the
+ *   proof of each equation, in the order of the legacy layout;
+ * - 4 * (n + 1) bytes: offset of each section from the beginning of the
+ *   proof, followed by the total length of the proof. */
+#define PROOF_MAGIC_0 'G'
+#define PROOF_MAGIC_1 'S'
+#define PROOF_FORMAT_VERSION 1
+#define PROOF_FLAG_UNCOMPRESSED 1
+
+inline void put_integer32(char *p, uint32_t v) {
+    v = htonl(v);
+    memcpy(p, &v, 4);
+}
+
+inline uint32_t get_integer32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+size_t NIZKProof::getHeaderLen() const {
+    size_t n = eqsFp.size() + eqsG1.size() + eqsG2.size() + eqsGT.size() + 1;
+    return 8 + getHashLen() + 4 * (n + 1);
+}
+
+void NIZKProof::getStatementHash() {
+    /* Computed once, as it requires the serialization of the statement */
+    std::ostringstream out;
+    out << *this;
+    std::string statement = out.str();
+    statementHash.resize(getHashLen());
+    getHash(statement.data(), statement.size(), &statementHash[0]);
+}
+
+size_t NIZKProof::putHeader(char *buf, size_t bodyLen) const {
+    size_t headerLen = getHeaderLen();
+    std::vector<size_t> offsets;
+    /* Sections of the body (see checkProofFrom for the order) */
+    BufferReader reader(buf + headerLen, bodyLen, compressedPoints);
+    offsets.push_back(headerLen);
+    for (int i = varsFp.size(); i-- > 0;)
+        skipElements(reader, 2, varsFpInB1[i] ? reader.lenG1 : reader.lenG2);
+    skipElements(reader, varsG1.size() << 1, reader.lenG1);
+    skipElements(reader, varsG2.size() << 1, reader.lenG2);
+    offsets.push_back(reader.p - buf);
+    for (int i = eqsFp.size(); i-- > 0;) {
+        skipEqProof(reader, tFp[i]);
+        offsets.push_back(reader.p - buf);
+    }
+    for (int i = eqsG1.size(); i-- > 0;) {
+        skipEqProof(reader, tG1[i]);
+        offsets.push_back(reader.p - buf);
+    }
+    for (int i = eqsG2.size(); i-- > 0;) {
+        skipEqProof(reader, tG2[i]);
+        offsets.push_back(reader.p - buf);
+    }
+    for (int i = eqsGT.size(); i-- > 0;) {
+        skipEqProof(reader, tGT[i]);
+        offsets.push_back(reader.p - buf);
+    }
+    ASSERT((!reader.fail) && (reader.p == reader.end), "Wrong proof layout");
+    char *p = buf;
+    *(p++) = PROOF_MAGIC_0;
+    *(p++) = PROOF_MAGIC_1;
+    *(p++) = PROOF_FORMAT_VERSION;
+    *(p++) = (compressedPoints ? 0 : PROOF_FLAG_UNCOMPRESSED);
+    memcpy(p, statementHash.data(), statementHash.size());
+    p += statementHash.size();
+    put_integer32(p, offsets.size() - 1);
+    for (size_t offset : offsets)
+        put_integer32(p += 4, offset);
+    return offsets.back();
+}
+
+bool NIZKProof::checkIndexedProof(const char *data, size_t len,
+                                  const CRS &crs,
+                                  const ProofData &instantiation) const {
+    if (!fixed) return false;
+    size_t headerLen = getHeaderLen();
+    int hashLen = getHashLen();
+    if ((len < headerLen) || (data[0] != PROOF_MAGIC_0) ||
+            (data[1] != PROOF_MAGIC_1) || (data[2] != PROOF_FORMAT_VERSION) ||
+            (data[3] & ~PROOF_FLAG_UNCOMPRESSED))
+        return false;
+    /* The encoding of the elements is given by the header, whatever the
+     * setting of this object */
+    bool compressed = !(data[3] & PROOF_FLAG_UNCOMPRESSED);
+    if (memcmp(statementHash.data(), data + 4, hashLen))
+        return false;
+    const char *p = data + 4 + hashLen;
+    size_t n = eqsFp.size() + eqsG1.size() + eqsG2.size() + eqsGT.size() + 1;
+    if (get_integer32(p) != n)
+        return false;
+    std::vector<const char*> sections;
+    size_t previous = headerLen;
+    for (size_t i = 0; i <= n; ++i) {
+        size_t offset = get_integer32(p += 4);
+        if ((offset < previous) || (offset > len) ||
+                ((i == 0) && (offset != headerLen)))
+            return false;
+        sections.push_back(data + offset);
+        previous = offset;
+    }
+    if (previous != len)
+        return false;
+    BufferReader reader(sections[0], sections[1] - sections[0], compressed);
+    sections.erase(sections.begin());
+    if (!checkProofFrom(reader, crs, instantiation, &sections))
+        return false;
+    return reader.p == reader.end;
+}
+
+template <class T>
+BT NIZKProof::getRndProofPart(T &stream, EqProofType t,
                               const CRS &crs) const {
     switch (t) {
     case EQ_TYPE_PPE:
@@ -3946,12 +5516,10 @@ BT NIZKProof::getRndProofPart(std::istream &stream, EqProofType t,
     }
     case EQ_TYPE_MLin_G:
     {
-        Fp k;
-        stream >> k;
-        B1 b1 = k * crs.v1;
+        Fp k, l;
         stream >> k;
-        b1 += k * crs.w1;
-        return BT::pairing(b1, crs.u2);
+        stream >> l;
+        return BT::pairing(crs.combine<B1>(k, l), crs.u2);
     }
     case EQ_TYPE_MConst_H:
     {
@@ -3961,12 +5529,10 @@ BT NIZKProof::getRndProofPart(std::istream &stream, EqProofType t,
     }
     case EQ_TYPE_MLin_H:
     {
-        Fp k;
-        stream >> k;
-        B2 b2 = k * crs.v2;
+        Fp k, l;
         stream >> k;
-        b2 += k * crs.w2;
-        return BT::pairing(crs.u1, b2);
+        stream >> l;
+        return BT::pairing(crs.u1, crs.combine<B2>(k, l));
     }
     case EQ_TYPE_QConst_G:
     {
@@ -3988,6 +5554,47 @@ BT NIZKProof::getRndProofPart(std::istream &stream, EqProofType t,
 
 bool NIZKProof::checkProof(std::istream &stream, const CRS &crs,
                 const ProofData &instantiation) const {
+    if (format == IndexedFormat) {
+        /* The total length is at the end of the header */
+        if (!fixed) return false;
+        size_t headerLen = getHeaderLen();
+        std::vector<char> buf(headerLen);
+        if (!stream.read(buf.data(), headerLen))
+            return false;
+        size_t len = get_integer32(buf.data() + headerLen - 4);
+        if ((len < headerLen) ||
+                (len > std::max(getProofSize(true), getProofSize(false))))
+            return false;
+        buf.resize(len);
+        if (!stream.read(buf.data() + headerLen, len - headerLen))
+            return false;
+        return checkIndexedProof(buf.data(), len, crs, instantiation);
+    }
+    if (!compressedPoints) {
+        /* Uncompressed proofs have a fixed length */
+        if (!fixed) return false;
+        std::vector<char> buf(proofSize());
+        if (!stream.read(buf.data(), buf.size()))
+            return false;
+        return checkProof(buf.data(), buf.size(), crs, instantiation);
+    }
+    return checkProofFrom(stream, crs, instantiation);
+}
+
+bool NIZKProof::checkProof(const char *data, size_t len, const CRS &crs,
+                           const ProofData &instantiation) const {
+    if (format == IndexedFormat)
+        return checkIndexedProof(data, len, crs, instantiation);
+    BufferReader reader(data, len, compressedPoints);
+    if (!checkProofFrom(reader, crs, instantiation))
+        return false;
+    return reader.p == reader.end;
+}
+
+template <class T>
+bool NIZKProof::checkProofFrom(T &stream, const CRS &crs,
+        const ProofData &instantiation,
+        const std::vector<const char*> *sections) const {
     if (!fixed) return false;
     if ((instantiation.pubFp.size() != cstsFp.size()) ||
             (instantiation.pubG1.size() != cstsG1.size()) ||
@@ -3996,31 +5603,34 @@ bool NIZKProof::checkProof(std::istream &stream, const CRS &crs,
         return false;
     ASSERT(varsFp.size() == varsFpInB1.size(), "Array sizes do not match");
     ASSERT(cstsFp.size() == cstsFpInB1.size(), "Array sizes do not match");
-    B1 b1;
-    B2 b2;
+    bool result = false;
+    BT rndProofPart;
+    std::string data;
+    std::vector<size_t> offsets, commitments;
+    std::vector<const char*> bounds;
+    RawCommitments raw;
+    bool compressed = isCompressed(stream);
+    int lenG1 = G1::getDataLen(compressed);
+    int lenG2 = G2::getDataLen(compressed);
+    /* The commitments are kept raw until an equation needs them */
     for (int i = varsFp.size(); i-- > 0;) {
-        if (varsFpInB1[i]) {
-            stream >> b1;
-            varsFp[i]->d = reinterpret_cast<void*>(new B1(b1));
-        } else {
-            stream >> b2;
-            varsFp[i]->d = reinterpret_cast<void*>(new B2(b2));
-        }
+        commitments.push_back(data.size());
+        readElements(stream, 2, varsFpInB1[i] ? lenG1 : lenG2, data);
     }
     for (int i = varsG1.size(); i-- > 0;) {
-        stream >> b1;
-        varsG1[i]->d = reinterpret_cast<void*>(new B1(b1));
+        commitments.push_back(data.size());
+        readElements(stream, 2, lenG1, data);
     }
     for (int i = varsG2.size(); i-- > 0;) {
-        stream >> b2;
-        varsG2[i]->d = reinterpret_cast<void*>(new B2(b2));
+        commitments.push_back(data.size());
+        readElements(stream, 2, lenG2, data);
     }
     for (int i = cstsFp.size(); i-- > 0;) {
         if (cstsFpInB1[i]) {
-            varsFp[i]->d = reinterpret_cast<void*>(new B1(
+            cstsFp[i]->d = reinterpret_cast<void*>(new B1(
                     instantiation.pubFp[i], crs));
         } else {
-            varsFp[i]->d = reinterpret_cast<void*>(new B2(
+            cstsFp[i]->d = reinterpret_cast<void*>(new B2(
                     instantiation.pubFp[i], crs));
         }
     }
@@ -4030,34 +5640,94 @@ bool NIZKProof::checkProof(std::istream &stream, const CRS &crs,
         cstsG2[i]->d = reinterpret_cast<void*>(new B2(instantiation.pubG2[i]));
     for (int i = cstsGT.size(); i-- > 0;)
         cstsGT[i]->d = reinterpret_cast<void*>(new BT(instantiation.pubGT[i]));
-    bool result = false;
-    BT rndProofPart;
-    for (int i = eqsFp.size(); i-- > 0;) {
-        const FpData &left = *eqsFp[i].first;
-        const FpData &right = *eqsFp[i].second;
-        rndProofPart = getRndProofPart(stream, tFp[i], crs);
-        if (calcExpr(left, crs) != calcExpr(right, crs) * rndProofPart)
-            goto cleanup;
-    }
-    for (int i = eqsG1.size(); i-- > 0;) {
-        const G1Data &left = *eqsG1[i].first;
-        const G1Data &right = *eqsG1[i].second;
-        rndProofPart = getRndProofPart(stream, tG1[i], crs);
-        if (calcExpr(left, crs) != calcExpr(right, crs) * rndProofPart)
-            goto cleanup;
-    }
-    for (int i = eqsG2.size(); i-- > 0;) {
-        const G2Data &left = *eqsG2[i].first;
-        const G2Data &right = *eqsG2[i].second;
-        rndProofPart = getRndProofPart(stream, tG2[i], crs);
-        if (calcExpr(left, crs) != calcExpr(right, crs) * rndProofPart)
+    if (readFailed(stream))
+        goto cleanup;
+    if (!sections) {
+        /* The proofs of the equations are read first (without decoding
+         * their elements), so that the equations can be checked in any
+         * order */
+        for (int i = eqsFp.size(); i-- > 0;) {
+            offsets.push_back(data.size());
+            readEqProof(stream, tFp[i], data);
+        }
+        for (int i = eqsG1.size(); i-- > 0;) {
+            offsets.push_back(data.size());
+            readEqProof(stream, tG1[i], data);
+        }
+        for (int i = eqsG2.size(); i-- > 0;) {
+            offsets.push_back(data.size());
+            readEqProof(stream, tG2[i], data);
+        }
+        for (int i = eqsGT.size(); i-- > 0;) {
+            offsets.push_back(data.size());
+            readEqProof(stream, tGT[i], data);
+        }
+        offsets.push_back(data.size());
+        if (readFailed(stream))
             goto cleanup;
-    }
-    for (int i = eqsGT.size(); i-- > 0;) {
-        const GTData &left = *eqsGT[i].first;
-        const GTData &right = *eqsGT[i].second;
-        rndProofPart = getRndProofPart(stream, tGT[i], crs);
-        if (calcExpr(left, crs) != calcExpr(right, crs) * rndProofPart)
+        for (size_t offset : offsets)
+            bounds.push_back(data.data() + offset);
+        sections = &bounds;
+    }
+    raw.end = data.data() + data.size();
+    raw.compressed = compressed;
+    raw.fp.resize(varsFp.size());
+    raw.g1.resize(varsG1.size());
+    raw.g2.resize(varsG2.size());
+    raw.fpInB1 = &varsFpInB1;
+    {
+        std::vector<size_t>::const_iterator it = commitments.begin();
+        for (int i = varsFp.size(); i-- > 0;)
+            raw.fp[i] = data.data() + *(it++);
+        for (int i = varsG1.size(); i-- > 0;)
+            raw.g1[i] = data.data() + *(it++);
+        for (int i = varsG2.size(); i-- > 0;)
+            raw.g2[i] = data.data() + *(it++);
+    }
+    /* Cheapest equations first, so that wrong proofs are rejected early */
+    for (int k : checkOrder) {
+        BufferReader reader((*sections)[k],
+                            (*sections)[k + 1] - (*sections)[k], compressed);
+        BT left, right;
+        int i = k;
+        if (i < (int) eqsFp.size()) {
+            i = eqsFp.size() - 1 - i;
+            rndProofPart = getRndProofPart(reader, tFp[i], crs);
+            if (readFailed(reader) || (reader.p != reader.end) ||
+                    !loadCommitments(*eqsFp[i].first, raw) ||
+                    !loadCommitments(*eqsFp[i].second, raw))
+                goto cleanup;
+            left = calcExpr(*eqsFp[i].first, crs);
+            right = calcExpr(*eqsFp[i].second, crs);
+        } else if ((i -= eqsFp.size()) < (int) eqsG1.size()) {
+            i = eqsG1.size() - 1 - i;
+            rndProofPart = getRndProofPart(reader, tG1[i], crs);
+            if (readFailed(reader) || (reader.p != reader.end) ||
+                    !loadCommitments(*eqsG1[i].first, raw) ||
+                    !loadCommitments(*eqsG1[i].second, raw))
+                goto cleanup;
+            left = calcExpr(*eqsG1[i].first, crs);
+            right = calcExpr(*eqsG1[i].second, crs);
+        } else if ((i -= eqsG1.size()) < (int) eqsG2.size()) {
+            i = eqsG2.size() - 1 - i;
+            rndProofPart = getRndProofPart(reader, tG2[i], crs);
+            if (readFailed(reader) || (reader.p != reader.end) ||
+                    !loadCommitments(*eqsG2[i].first, raw) ||
+                    !loadCommitments(*eqsG2[i].second, raw))
+                goto cleanup;
+            left = calcExpr(*eqsG2[i].first, crs);
+            right = calcExpr(*eqsG2[i].second, crs);
+        } else {
+            i = eqsGT.size() - 1 - (i - eqsG2.size());
+            rndProofPart = getRndProofPart(reader, tGT[i], crs);
+            if (readFailed(reader) || (reader.p != reader.end) ||
+                    !loadCommitments(*eqsGT[i].first, raw) ||
+                    !loadCommitments(*eqsGT[i].second, raw))
+                goto cleanup;
+            left = calcExpr(*eqsGT[i].first, crs);
+            right = calcExpr(*eqsGT[i].second, crs);
+        }
+        if (left != right * rndProofPart)
             goto cleanup;
     }
     result = true;
@@ -4086,6 +5756,29 @@ cleanup:
         removeCalculations(left);
         removeCalculations(right);
     }
+    /* Commitments that were not reached by the calculations */
+    for (int i = varsFp.size(); i-- > 0;) {
+        if (varsFpInB1[i])
+            removeLeftCalc(*varsFp[i]);
+        else
+            removeRightCalc(*varsFp[i]);
+    }
+    for (int i = cstsFp.size(); i-- > 0;) {
+        if (cstsFpInB1[i])
+            removeLeftCalc(*cstsFp[i]);
+        else
+            removeRightCalc(*cstsFp[i]);
+    }
+    for (int i = varsG1.size(); i-- > 0;)
+        removeLeftCalc(*varsG1[i]);
+    for (int i = cstsG1.size(); i-- > 0;)
+        removeLeftCalc(*cstsG1[i]);
+    for (int i = varsG2.size(); i-- > 0;)
+        removeRightCalc(*varsG2[i]);
+    for (int i = cstsG2.size(); i-- > 0;)
+        removeRightCalc(*cstsG2[i]);
+    for (int i = cstsGT.size(); i-- > 0;)
+        removeCalculations(*cstsGT[i]);
     return result;
 }
 
@@ -4461,6 +6154,25 @@ void NIZKProof::simulateProof(std::ostream &stream, const CRS &crs,
             (instantiation.pubG2.size() != cstsG2.size()) ||
             (instantiation.pubGT.size() != cstsGT.size()))
         throw "Wrong instantiation in NIZKProof::simulateProof!";
+    if ((format == IndexedFormat) || !compressedPoints) {
+        /* Same as in writeProof */
+        std::vector<char> buf(proofSize());
+        char *body = buf.data() + ((format == IndexedFormat) ?
+                                   getHeaderLen() : 0);
+        BufferWriter writer(body, compressedPoints);
+        simulateProofTo(writer, crs, instantiation);
+        size_t len = writer.p - buf.data();
+        if (format == IndexedFormat)
+            len = putHeader(buf.data(), writer.p - body);
+        stream.write(buf.data(), len);
+        return;
+    }
+    simulateProofTo(stream, crs, instantiation);
+}
+
+template <class T>
+void NIZKProof::simulateProofTo(T &stream, const CRS &crs,
+                                const ProofData &instantiation) const {
     ASSERT(varsFp.size() == varsFpInB1.size(), "Array sizes do not match");
     ASSERT(cstsFp.size() == cstsFpInB1.size(), "Array sizes do not match");
     ASSERT(cstsGT.empty(), "Unexpected non-ZK property");
@@ -13,6 +13,7 @@
 #include <vector>
 #include <iostream>
 #include <set>
+#include <string>
 
 /**
  * @file gsnizk.h
@@ -51,6 +52,7 @@ struct FpData;
 struct G1Data;
 struct G2Data;
 struct GTData;
+struct EvalCache;
 
 typedef std::pair< std::shared_ptr<FpData>, std::shared_ptr<FpData> > PairFp;
 typedef std::pair< std::shared_ptr<G1Data>, std::shared_ptr<G1Data> > PairG1;
@@ -515,6 +517,139 @@ struct ProofData {
     std::vector<GT> pubGT;
 };
 
+/**
+ * @brief The ProofCost structure.
+ *
+ * This structure holds the estimated cost of generating and verifying
+ * a proof for a fixed system of equations.
+ * It is returned by @ref NIZKProof::estimateCost().
+ *
+ * @note Multiplications and pairings that are trivial because of
+ *   the structure of the equations (e.g. involving the null
+ *   component of a public constant converted to
+ *   @f$\mathbb{B}_1@f$ or @f$\mathbb{B}_2@f$) are not counted,
+ *   as the backends skip them. Operations that only become trivial
+ *   because of the actual values used (e.g. a scalar equal to 1)
+ *   are still counted.
+ */
+struct ProofCost {
+    /**
+     * @brief Number of commitments in @f$\mathbb{B}_1@f$
+     *   (of @f$\mathbb{F}_p@f$ and @f$\mathbb{G}_1@f$ variables).
+     */
+    int commitmentsB1;
+    /**
+     * @brief Number of commitments in @f$\mathbb{B}_2@f$
+     *   (of @f$\mathbb{F}_p@f$ and @f$\mathbb{G}_2@f$ variables).
+     */
+    int commitmentsB2;
+    /**
+     * @brief Number of @f$\mathbb{G}_1@f$ variables that are only
+     *   encrypted instead of being fully committed.
+     */
+    int encryptedG1;
+    /**
+     * @brief Number of @f$\mathbb{G}_2@f$ variables that are only
+     *   encrypted instead of being fully committed.
+     */
+    int encryptedG2;
+    /**
+     * @brief Number of scalar multiplications in @f$\mathbb{G}_1@f$
+     *   performed when writing a proof.
+     *
+     * A joint evaluation of two multiples of fixed elements
+     * (see pairings::G1JointTable) counts as one multiplication.
+     */
+    int proverMultsG1;
+    /**
+     * @brief Number of scalar multiplications in @f$\mathbb{G}_2@f$
+     *   performed when writing a proof.
+     *
+     * A joint evaluation of two multiples of fixed elements
+     * (see pairings::G2JointTable) counts as one multiplication.
+     */
+    int proverMultsG2;
+    /**
+     * @brief Number of pairings (Miller loops) computed when checking
+     *   a valid proof.
+     */
+    int verifierPairings;
+    /**
+     * @brief Number of pairing products (final exponentiations) computed
+     *   when checking a valid proof.
+     */
+    int verifierPairingProducts;
+    /**
+     * @brief Maximal size of a proof, in bytes.
+     * @sa NIZKProof::proofSize()
+     */
+    size_t proofSize;
+};
+
+/**
+ * @brief The CostWeights structure.
+ *
+ * This structure holds the relative cost of each operation counted in a
+ * @ref ProofCost. It is used to choose the type of commitments when
+ * @ref NIZKProof::Auto is selected.
+ *
+ * The default values are expressed in units of a scalar multiplication in
+ * @f$\mathbb{G}_1@f$, and do not take the proof size into account.
+ */
+struct CostWeights {
+    /**
+     * @brief Constructs the default weights.
+     */
+    inline CostWeights();
+    /**
+     * @brief Measures the actual cost of each operation with the
+     *   current backend.
+     *
+     * The cost is the average running time of each operation,
+     * in microseconds.
+     *
+     * @note The pairings need to have been initialized.
+     * @param iterations Number of runs of each operation.
+     * @return The measured weights, with the weights of
+     *   @ref prover and @ref verifier set to 1 and @ref proofByte to 0.
+     */
+    static CostWeights measure(int iterations = 10);
+    /**
+     * @brief Computes the weighted cost.
+     * @param cost Operation counts.
+     * @return The weighted sum of the operation counts.
+     */
+    double getCost(const ProofCost &cost) const;
+    /**
+     * @brief Cost of a scalar multiplication in @f$\mathbb{G}_1@f$.
+     */
+    double multG1;
+    /**
+     * @brief Cost of a scalar multiplication in @f$\mathbb{G}_2@f$.
+     */
+    double multG2;
+    /**
+     * @brief Cost of a single pairing (Miller loop).
+     */
+    double pairing;
+    /**
+     * @brief Cost of a pairing product (final exponentiation).
+     */
+    double pairingProduct;
+    /**
+     * @brief Factor applied to the cost of writing a proof.
+     */
+    double prover;
+    /**
+     * @brief Factor applied to the cost of checking a proof.
+     */
+    double verifier;
+    /**
+     * @brief Cost of each byte of the proof.
+     */
+    double proofByte;
+};
+
 /**
  * @brief The main class that generates and verifies NIZK proofs.
  */
@@ -523,12 +658,30 @@ public:
     enum CommitType {
         NormalCommit = 0,
         SelectedEncryption = 1,
-        AllEncrypted = 2
+        AllEncrypted = 2,
+        Auto = 3
+    };
+    /**
+     * @brief Layouts of the NIZK proofs.
+     *
+     * - @ref LegacyFormat: the commitments followed by the proof of each
+     *   equation, with no framing.
+     * - @ref IndexedFormat: the same data, preceded by a header with the
+     *   format version, the hash of the system of equations and the
+     *   offset of the commitments and of the proof of each equation.
+     */
+    enum ProofFormat {
+        LegacyFormat = 0,
+        IndexedFormat = 1
     };
 public:
     /**
      * @brief Contructs a new NIZKProof object ready to accept equations.
      * @param type The desired type of commitments.
+     * @note With the type @ref Auto, the system of equations is compiled
+     *   with each of the other types in @ref endEquations(), and the
+     *   cheapest one is kept.
+     * @sa NIZKProof::setCostWeights()
      */
     inline NIZKProof(CommitType type = CommitType::SelectedEncryption);
     /**
@@ -589,6 +742,72 @@ public:
      * @return `true` if the indexes are consistent, `false` otherwise.
      */
     bool endEquations();
+    /**
+     * @brief Sets how the type of commitments is chosen when the type
+     *   @ref Auto has been selected.
+     * @warning This function needs to be called before
+     *   @ref endEquations() to have any effect.
+     * @param weights Relative cost of each operation.
+     * @param preferZK Whether the types of commitments that make the
+     *   system of equations Zero-Knowledge should be preferred, whenever
+     *   there is one, regardless of their cost.
+     * @sa NIZKProof::estimateCost()
+     * @sa CostWeights::measure()
+     */
+    void setCostWeights(const CostWeights &weights, bool preferZK = true);
+    /**
+     * @brief Sets whether the side (@f$B_1@f$ or @f$B_2@f$) of each
+     *   variable and constant in @f$\mathbb{F}_p@f$ is optimized.
+     *
+     * By default, the side of a scalar is the one of its first use in
+     * the equations, and the commitment is duplicated (with an
+     * additional equation) whenever it is used on the other side.
+     * When this option is enabled, @ref endEquations() starts from this
+     * greedy placement and then forces the other side for the scalars
+     * one at a time, the remaining ones being placed greedily and the
+     * products in @f$\mathbb{F}_p@f$ being oriented accordingly, as
+     * long as the estimated cost decreases. The greedy placement is kept
+     * whenever no other placement is cheaper.
+     *
+     * @warning This function needs to be called before
+     *   @ref endEquations() to have any effect.
+     * @param enabled Whether the placement should be optimized.
+     * @sa NIZKProof::setCostWeights()
+     */
+    void setOptimizedFpPlacement(bool enabled = true);
+    /**
+     * @brief Sets the layout of the proofs written and checked with this
+     *   system of equations.
+     *
+     * Both the prover and the verifier need to use the same format,
+     * which is @ref LegacyFormat by default. The format is not part of
+     * the serialized system of equations.
+     *
+     * @param format Layout of the proofs.
+     * @sa NIZKProof::writeProof(std::ostream&,const CRS&,const ProofData&)
+     * @sa NIZKProof::checkProof(std::istream&,const CRS&,const ProofData&)
+     */
+    void setProofFormat(ProofFormat format);
+    /**
+     * @brief Sets whether the group elements of the proofs are written
+     *   in compressed form.
+     *
+     * Compressed elements (the default) are about half the size of
+     * uncompressed ones, but the verifier needs a square root to decode
+     * each of them. Without compression, the elements are written with
+     * the `getData(data, false)` encoding of @ref G1 and @ref G2, which
+     * is faster to decode.
+     *
+     * With the @ref IndexedFormat, the encoding is recorded in the header
+     * of the proofs and the verifier follows it whatever its own setting.
+     * With the @ref LegacyFormat, the prover and the verifier need to use
+     * the same setting.
+     *
+     * @param enabled Whether the group elements should be compressed.
+     * @sa NIZKProof::setProofFormat()
+     * @sa NIZKProof::proofSize()
+     */
+    void setPointCompression(bool enabled = true);
     /**
      * @brief Performs a deep copy of the NIZKProof object @a other.
      * @param other NIZKProof object to copy.
@@ -629,6 +848,14 @@ public:
      * @param crs The Common Reference String that is used for the
      *   base elements. A dummy CRS may be used in cases where no
      *   base element is used (excluding @f$\mathbb{F}_p@f$'s base element).
+     * @param randomized If `true`, the equations of each type are merged
+     *   into a single random linear combination (and all the pairing
+     *   product equations into a single multi-pairing) which is then
+     *   checked once. A wrong solution is accepted only with negligible
+     *   probability.
+     * @note Shared subexpressions are evaluated only once per call, and
+     *   the pairings of each pairing product equation are computed with a
+     *   single multi-pairing.
      * @note This function returns false if the instantiation vectors do
      *   not have the required size.
      * @return `true` if the values are a solution to the equations,
@@ -636,7 +863,7 @@ public:
      * @sa NIZKProof::endEquations()
      */
     bool verifySolution(const ProofData &instantiation,
-                        const CRS &crs = CRS()) const;
+                        const CRS &crs = CRS(), bool randomized = false) const;
     /**
      * @brief Writes a NIZK proof to a stream.
      * @warning The user should call the function @ref endEquations()
@@ -651,12 +878,79 @@ public:
      *   variables.
      * @sa NIZKProof::endEquations()
      * @sa NIZKProof::checkProof(std::istream&,const CRS&, const ProofData&)
-     * @sa NIZKProof::verifySolution(const ProofData&,const CRS&)
+     * @sa NIZKProof::verifySolution(const ProofData&,const CRS&,bool)
      */
     void writeProof(std::ostream &stream, const CRS &crs,
                     const ProofData &instantiation) const;
+    /**
+     * @brief Writes a NIZK proof to a buffer.
+     *
+     * The data written is the same as with
+     * @ref writeProof(std::ostream&,const CRS&,const ProofData&),
+     * but it is serialized directly into the memory provided by the caller.
+     *
+     * @warning The user should call the function @ref endEquations()
+     *   before calling this function.
+     * @warning It is assumed that the given values are a solution of the
+     *   equations for the proof to be correct. This can be checked with
+     *   the method @ref verifySolution(). If the instantiation size is not
+     *   correct, the function leads to undefined behavior.
+     * @param buf Buffer to which the NIZK proof shall be written.
+     * @param len Size of the buffer @a buf, which should be at least
+     *   @ref proofSize() bytes long.
+     * @param crs Common Reference String to use for this proof.
+     * @param instantiation Instantiation values for the constants and
+     *   variables.
+     * @return The number of bytes actually written to @a buf.
+     * @sa NIZKProof::proofSize()
+     * @sa NIZKProof::writeProof(std::ostream&,const CRS&, const ProofData&)
+     */
+    size_t writeProof(char *buf, size_t len, const CRS &crs,
+                      const ProofData &instantiation) const;
+    /**
+     * @brief Returns the maximal size of a NIZK proof for this system.
+     *
+     * The actual proof may be slightly shorter, since null
+     * group elements are written with a single byte when compressed
+     * (see @ref setPointCompression()).
+     * The header of the @ref IndexedFormat is included.
+     *
+     * @warning The user should call the function @ref endEquations()
+     *   before calling this function.
+     * @return The maximal size of a NIZK proof, in bytes.
+     * @sa NIZKProof::writeProof(char*,size_t,const CRS&,const ProofData&)
+     */
+    size_t proofSize() const;
+    /**
+     * @brief Estimates the cost of writing and checking a proof.
+     *
+     * The operation counts are derived from the equation proof types,
+     * the type of commitment of each variable and the side on which each
+     * @f$\mathbb{F}_p@f$ variable is committed, without performing any
+     * group operation.
+     *
+     * @warning The user should call the function @ref endEquations()
+     *   before calling this function.
+     * @param crs Reserved: Common Reference String that will be used
+     *   for the proofs. It is currently ignored, since the counts are the
+     *   same for all the types of CRS (the commitments and the linear
+     *   combinations of the CRS elements are evaluated with joint tables,
+     *   see CRS::combine).
+     * @return The estimated cost.
+     * @sa NIZKProof::endEquations()
+     * @sa NIZKProof::proofSize()
+     */
+    ProofCost estimateCost(const CRS &crs) const;
     /**
      * @brief Checks a NIZK proof from a stream.
+     *
+     * The commitments and the proofs of the equations are read first,
+     * without decoding their elements. The equations are then checked by
+     * increasing estimated cost (see @ref setCostWeights()), and the
+     * check stops at the first one that does not verify. Each element is
+     * only decoded when the first equation using it is checked, so that
+     * a rejected proof only costs what was actually inspected.
+     *
      * @warning The user should call the function @ref endEquations()
      *   before calling this function.
      * @param stream Input stream from which the NIZK proof is to be read.
@@ -669,6 +963,28 @@ public:
      */
     bool checkProof(std::istream &stream, const CRS &crs,
                     const ProofData &instantiation) const;
+    /**
+     * @brief Checks a NIZK proof from a buffer.
+     *
+     * The elements are decoded directly from @a data, which should hold
+     * exactly what @ref writeProof() produced. Truncated input, trailing
+     * data or malformed element encodings make the check fail instead of
+     * throwing an exception. The equations are checked in the same order
+     * as in @ref checkProof(std::istream&,const CRS&,const ProofData&).
+     *
+     * @warning The user should call the function @ref endEquations()
+     *   before calling this function.
+     * @param data Pointer to the NIZK proof data.
+     * @param len Length of the NIZK proof data.
+     * @param crs Common Reference String to use for this proof.
+     * @param instantiation Instantiation values for the constants.
+     * @note The instantiation vectors for the variables are ignored.
+     * @return `true` if the NIZK proof verifies, `false` otherwise.
+     * @sa NIZKProof::endEquations()
+     * @sa NIZKProof::writeProof(char*,size_t,const CRS&,const ProofData&)
+     */
+    bool checkProof(const char *data, size_t len, const CRS &crs,
+                    const ProofData &instantiation) const;
     /**
      * @brief Checks if the system of equations is Zero-Knowledge.
      * @note This function always returns `false` if the system has not
@@ -699,14 +1015,19 @@ public:
                        const ProofData &instantiation) const;
 private:
     bool checkInstantiation(const ProofData &instantiation) const;
+    bool chooseCommitType();
+    bool optimizeFpPlacement();
+    int getMismatch(const FpData &d, bool inB1) const;
+    ProofCost getCost() const;
+    std::vector<int> getCheckOrder() const;
     void getIndexes(std::shared_ptr<FpData> &d);
     void getIndexes(std::shared_ptr<G1Data> &d);
     void getIndexes(std::shared_ptr<G2Data> &d);
     void getIndexes(std::shared_ptr<GTData> &d);
-    void checkoutAsFp(std::shared_ptr<FpData> &d);
-    void checkoutAsG1(std::shared_ptr<G1Data> &d);
-    void checkoutAsG2(std::shared_ptr<G2Data> &d);
-    void checkoutAsGT(std::shared_ptr<GTData> &d);
+    void checkoutAsFp(std::shared_ptr<FpData> &dp);
+    void checkoutAsG1(std::shared_ptr<G1Data> &dp);
+    void checkoutAsG2(std::shared_ptr<G2Data> &dp);
+    void checkoutAsGT(std::shared_ptr<GTData> &dp);
     void checkoutLeft(std::shared_ptr<FpData> &d);
     void checkoutLeft(std::shared_ptr<G1Data> &d);
     void checkoutRight(std::shared_ptr<FpData> &d);
@@ -719,6 +1040,16 @@ private:
                  const CRS &crs) const;
     GT real_eval(const GTData &d, const ProofData &instantiation,
                  const CRS &crs) const;
+    Fp cached_eval(const FpData &d, const ProofData &instantiation,
+                   const CRS &crs, EvalCache &cache) const;
+    G1 cached_eval(const G1Data &d, const ProofData &instantiation,
+                   const CRS &crs, EvalCache &cache) const;
+    G2 cached_eval(const G2Data &d, const ProofData &instantiation,
+                   const CRS &crs, EvalCache &cache) const;
+    void gatherPairings(const GTData &d, const ProofData &instantiation,
+                        const CRS &crs, bool inverse,
+                        std::vector< std::pair<G1,G2> > &pairs,
+                        GT &rest, EvalCache &cache) const;
     void readFromStream(std::istream &stream, std::shared_ptr<FpData> &dp,
                         int side);
     void readFromStream(std::istream &stream, std::shared_ptr<G1Data> &dp);
@@ -732,12 +1063,26 @@ private:
     ElTypeSet getPTLeft(const G1Data &d);
     ElTypeSet getPTRight(const FpData &d);
     ElTypeSet getPTRight(const G2Data &d);
-    void writeEqProof(std::ostream &stream, const void *leftp,
-                      const void *rightp, EqProofType expectedType,
-                      const CRS &crs) const;
+    template <class T> void writeProofTo(T &stream, const CRS &crs,
+                                         const ProofData &instantiation) const;
+    size_t getProofSize(bool compressed) const;
+    template <class T> void simulateProofTo(T &stream, const CRS &crs,
+            const ProofData &instantiation) const;
+    template <class T> void writeEqProof(T &stream, const void *leftp,
+                                         const void *rightp,
+                                         EqProofType expectedType,
+                                         const CRS &crs) const;
     void getEqProofTypes();
-    BT getRndProofPart(std::istream &stream, EqProofType t,
-                       const CRS &crs) const;
+    size_t getHeaderLen() const;
+    void getStatementHash();
+    size_t putHeader(char *buf, size_t bodyLen) const;
+    bool checkIndexedProof(const char *data, size_t len, const CRS &crs,
+                           const ProofData &instantiation) const;
+    template <class T> bool checkProofFrom(T &stream, const CRS &crs,
+            const ProofData &instantiation,
+            const std::vector<const char*> *sections = NULL) const;
+    template <class T> BT getRndProofPart(T &stream, EqProofType t,
+                                          const CRS &crs) const;
     void getProofZK(const FpData &d, const CRS &crs, EqProofType t) const;
     void getProofZK(const G1Data &d, const CRS &crs, EqProofType t) const;
     void getProofZK(const G2Data &d, const CRS &crs, EqProofType t) const;
@@ -748,6 +1093,12 @@ private:
     void getRightZK(const G2Data &d, const CRS &crs, EqProofType t) const;
 private:
     CommitType type;
+    CostWeights weights;
+    bool preferZK;
+    ProofFormat format;
+    bool compressedPoints;
+    bool optimizedFpPlacement, fpPreset;
+    std::vector<int> presetVarsFp, presetCstsFp;
     bool zk;
     std::vector<PairFp> eqsFp;
     std::vector<PairG1> eqsG1;
@@ -764,6 +1115,8 @@ private:
     std::vector<AdditionalFp> additionalFp;
     std::vector<AdditionalG1> additionalG1;
     std::vector<AdditionalG2> additionalG2;
+    std::vector<int> checkOrder;
+    std::string statementHash;
 };
 
 /**
@@ -788,8 +1141,13 @@ inline GTElement::GTElement() {}
 
 inline GTElement::GTElement(std::shared_ptr<GTData> d) : data(d) {}
 
+inline CostWeights::CostWeights() : multG1(1), multG2(2.5), pairing(2),
+    pairingProduct(3), prover(1), verifier(1), proofByte(0) {}
+
 inline NIZKProof::NIZKProof(CommitType type)
-    : type(type), zk(false), fixed(false) {}
+    : type(type), preferZK(true), format(LegacyFormat),
+    compressedPoints(true), optimizedFpPlacement(false),
+    fpPreset(false), zk(false), fixed(false) {}
 
 inline bool NIZKProof::isZeroKnowledge() { return zk; }
 
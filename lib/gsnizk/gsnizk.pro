@@ -49,12 +49,16 @@ DEFINES     += LIB_COMPILATION
 
 QT          -= core gui
 TARGET       = gsnizk
-CONFIG      += c++11
+CONFIG      += c++11 thread
 
 config_sha512 {
     DEFINES     += HASH_LEN_BITS=512
+    HEADERS     += sha512.h
+    SOURCES     += sha512.cpp
 } else {
     DEFINES     += HASH_LEN_BITS=256
+    HEADERS     += sha256.h
+    SOURCES     += sha256.cpp
 }
 
 config_lib {
@@ -74,6 +78,7 @@ config_lib {
 
 SOURCES     += pairings.cpp \
     bigendian.cpp \
+    chacha20.cpp \
     gsnizk.cpp \
     maps.cpp \
     tests.cpp \
@@ -81,6 +86,7 @@ SOURCES     += pairings.cpp \
 
 HEADERS     += pairings.h \
     bigendian.h \
+    chacha20.h \
     bigendian_cfg.h \
     gsnizk.h \
     maps.h \
@@ -21,11 +21,33 @@ namespace gsnizk {
 
 G1 B1::extract(const CRS &crs) const {
     ASSERT(crs.type == CRS_TYPE_EXTRACT, "Wrong type of CRS");
-    return _2 - (Fp::getUnit() / crs.j1) * _1;
+    return _2 - crs.ij1 * _1;
+}
+
+void B1::extractMany(const B1 *els, size_t n, const CRS &crs, G1 *out,
+                     int threads) {
+    ASSERT(crs.type == CRS_TYPE_EXTRACT, "Wrong type of CRS");
+    std::vector<G1> c(n);
+    for (size_t i = 0; i < n; ++i)
+        c[i] = els[i]._1;
+    G1::mulMany(c.data(), n, crs.ij1, c.data(), threads);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = els[i]._2 - c[i];
+}
+
+B1 B1::mulSum(const B1 *els, const ShortScalar *m, size_t n) {
+    std::vector<G1> c(2 * n);
+    for (size_t i = 0; i < n; ++i) {
+        c[i] = els[i]._1;
+        c[n + i] = els[i]._2;
+    }
+    return B1(G1::mulSum(c.data(), m, n), G1::mulSum(c.data() + n, m, n));
 }
 
 B1 B1::commit(const Fp &el, const Fp &r, const CRS &crs) {
-    return el * crs.u1 + r * crs.v1;
+    if (crs.uv1[0].isNull())
+        return el * crs.u1 + r * crs.v1;
+    return B1(crs.uv1[0].mult(el, r), crs.uv1[1].mult(el, r));
 }
 
 B1 B1::commit(const B1 &el, const Fp &r, const CRS &crs) {
@@ -33,18 +55,89 @@ B1 B1::commit(const B1 &el, const Fp &r, const CRS &crs) {
 }
 
 B1 B1::commit(const B1 &el, const Fp &r, const Fp &s, const CRS &crs) {
-    if (crs.type & 1)
-        return el + (r + crs.i1 * s) * crs.v1;
-    return el + r * crs.v1 + s * crs.w1;
+    return el + crs.combine<B1>(r, s);
+}
+
+void B1::commitMany(const Fp *els, const Fp *r, size_t n, const CRS &crs,
+                    B1 *out, int threads) {
+    if (crs.uv1[0].isNull()) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = commit(els[i], r[i], crs);
+        return;
+    }
+    std::vector<G1> c(2 * n);
+    crs.uv1[0].multMany(els, r, n, c.data(), threads);
+    crs.uv1[1].multMany(els, r, n, c.data() + n, threads);
+    G1::normalizeMany(c.data(), 2 * n);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = B1(c[i], c[n + i]);
+}
+
+void B1::commitMany(const B1 *els, const Fp *r, const Fp *s, size_t n,
+                    const CRS &crs, B1 *out, int threads) {
+    if (crs.uv1[0].isNull() ||
+            (s && !(crs.type & 1) && crs.vw1[0].isNull())) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = s ? commit(els[i], r[i], s[i], crs)
+                       : commit(els[i], r[i], crs);
+        return;
+    }
+    std::vector<G1> c(2 * n);
+    if (s && !(crs.type & 1)) {
+        crs.vw1[0].multMany(r, s, n, c.data(), threads);
+        crs.vw1[1].multMany(r, s, n, c.data() + n, threads);
+    } else {
+        /* r v1 + s w1 = (r + i1 s) v1 here (see CRS::combine),
+         * which is evaluated as 0 u1 + (r + i1 s) v1 */
+        std::vector<Fp> zero(n), rs;
+        const Fp *y = r;
+        if (s) {
+            rs.reserve(n);
+            for (size_t i = 0; i < n; ++i)
+                rs.push_back(r[i] + crs.i1 * s[i]);
+            y = rs.data();
+        }
+        crs.uv1[0].multMany(zero.data(), y, n, c.data(), threads);
+        crs.uv1[1].multMany(zero.data(), y, n, c.data() + n, threads);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        c[i] += els[i]._1;
+        c[n + i] += els[i]._2;
+    }
+    G1::normalizeMany(c.data(), 2 * n);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = B1(c[i], c[n + i]);
 }
 
 G2 B2::extract(const CRS &crs) const {
     ASSERT(crs.type == CRS_TYPE_EXTRACT, "Wrong type of CRS");
-    return _2 - (Fp::getUnit() / crs.j2) * _1;
+    return _2 - crs.ij2 * _1;
+}
+
+void B2::extractMany(const B2 *els, size_t n, const CRS &crs, G2 *out,
+                     int threads) {
+    ASSERT(crs.type == CRS_TYPE_EXTRACT, "Wrong type of CRS");
+    std::vector<G2> c(n);
+    for (size_t i = 0; i < n; ++i)
+        c[i] = els[i]._1;
+    G2::mulMany(c.data(), n, crs.ij2, c.data(), threads);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = els[i]._2 - c[i];
+}
+
+B2 B2::mulSum(const B2 *els, const ShortScalar *m, size_t n) {
+    std::vector<G2> c(2 * n);
+    for (size_t i = 0; i < n; ++i) {
+        c[i] = els[i]._1;
+        c[n + i] = els[i]._2;
+    }
+    return B2(G2::mulSum(c.data(), m, n), G2::mulSum(c.data() + n, m, n));
 }
 
 B2 B2::commit(const Fp &el, const Fp &r, const CRS &crs) {
-    return el * crs.u2 + r * crs.v2;
+    if (crs.uv2[0].isNull())
+        return el * crs.u2 + r * crs.v2;
+    return B2(crs.uv2[0].mult(el, r), crs.uv2[1].mult(el, r));
 }
 
 B2 B2::commit(const B2 &el, const Fp &r, const CRS &crs) {
@@ -52,15 +145,94 @@ B2 B2::commit(const B2 &el, const Fp &r, const CRS &crs) {
 }
 
 B2 B2::commit(const B2 &el, const Fp &r, const Fp &s, const CRS &crs) {
-    if (crs.type & 1)
-        return el + (r + crs.i2 * s) * crs.v2;
-    return el + r * crs.v2 + s * crs.w2;
+    return el + crs.combine<B2>(r, s);
+}
+
+void B2::commitMany(const Fp *els, const Fp *r, size_t n, const CRS &crs,
+                    B2 *out, int threads) {
+    if (crs.uv2[0].isNull()) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = commit(els[i], r[i], crs);
+        return;
+    }
+    std::vector<G2> c(2 * n);
+    crs.uv2[0].multMany(els, r, n, c.data(), threads);
+    crs.uv2[1].multMany(els, r, n, c.data() + n, threads);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = B2(c[i], c[n + i]);
+}
+
+void B2::commitMany(const B2 *els, const Fp *r, const Fp *s, size_t n,
+                    const CRS &crs, B2 *out, int threads) {
+    if (crs.uv2[0].isNull() ||
+            (s && !(crs.type & 1) && crs.vw2[0].isNull())) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = s ? commit(els[i], r[i], s[i], crs)
+                       : commit(els[i], r[i], crs);
+        return;
+    }
+    std::vector<G2> c(2 * n);
+    if (s && !(crs.type & 1)) {
+        crs.vw2[0].multMany(r, s, n, c.data(), threads);
+        crs.vw2[1].multMany(r, s, n, c.data() + n, threads);
+    } else {
+        /* r v2 + s w2 = (r + i2 s) v2 here (see CRS::combine),
+         * which is evaluated as 0 u2 + (r + i2 s) v2 */
+        std::vector<Fp> zero(n), rs;
+        const Fp *y = r;
+        if (s) {
+            rs.reserve(n);
+            for (size_t i = 0; i < n; ++i)
+                rs.push_back(r[i] + crs.i2 * s[i]);
+            y = rs.data();
+        }
+        crs.uv2[0].multMany(zero.data(), y, n, c.data(), threads);
+        crs.uv2[1].multMany(zero.data(), y, n, c.data() + n, threads);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        c[i] += els[i]._1;
+        c[n + i] += els[i]._2;
+    }
+    for (size_t i = 0; i < n; ++i)
+        out[i] = B2(c[i], c[n + i]);
 }
 
 GT BT::extract(const CRS &crs) const {
     ASSERT(crs.type == CRS_TYPE_EXTRACT, "Wrong type of CRS");
-    Fp p = Fp(-1) / crs.j1;
-    return (_22 * (_12 ^ p)) * ((_21 * (_11 ^ p)) ^ (Fp(-1) / crs.j2));
+    Fp p = -crs.ij1;
+    return (_22 * (_12 ^ p)) * ((_21 * (_11 ^ p)) ^ (-crs.ij2));
+}
+
+void BT::extractMany(const BT *els, size_t n, const CRS &crs, GT *out,
+                     int threads) {
+    ASSERT(crs.type == CRS_TYPE_EXTRACT, "Wrong type of CRS");
+    /* c[i] = _12 and c[n + i] = _11, raised to the same power first */
+    std::vector<GT> c(2 * n);
+    for (size_t i = 0; i < n; ++i) {
+        c[i] = els[i]._12;
+        c[n + i] = els[i]._11;
+    }
+    GT::powMany(c.data(), 2 * n, -crs.ij1, c.data(), threads);
+    for (size_t i = 0; i < n; ++i) {
+        c[i] *= els[i]._22;
+        c[n + i] *= els[i]._21;
+    }
+    GT::powMany(c.data() + n, n, -crs.ij2, c.data() + n, threads);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = c[i] * c[n + i];
+}
+
+BT BT::powProd(const BT *els, const ShortScalar *m, size_t n) {
+    std::vector<GT> c(4 * n);
+    for (size_t i = 0; i < n; ++i) {
+        c[i] = els[i]._11;
+        c[n + i] = els[i]._12;
+        c[2 * n + i] = els[i]._21;
+        c[3 * n + i] = els[i]._22;
+    }
+    return BT(GT::powProd(c.data(), m, n), GT::powProd(c.data() + n, m, n),
+              GT::powProd(c.data() + 2 * n, m, n),
+              GT::powProd(c.data() + 3 * n, m, n));
 }
 
 BT BT::pairing(const B1 &a, const B2 &b) {
@@ -99,66 +271,105 @@ void CRS::makePublic() {
         i2 = Fp();
         j1 = Fp();
         j2 = Fp();
+        ij1 = Fp();
+        ij2 = Fp();
         type = CRS_TYPE_PUBLIC;
     }
 }
 
 CRS CRS::genPrivate(std::ostream &stream) const {
-    if (type != CRS_TYPE_PUBLIC)
-        throw "Unexpected use of gsnizk::genPrivate";
     CRS priv;
-    priv.type = CRS_TYPE_PRIVATE;
-    priv.v1 = v1;
-    priv.i1 = Fp::getRand();
-    priv.v2 = v2;
-    priv.i2 = Fp::getRand();
-    priv.computeElements(false);
-    Fp r_rho = Fp::getRand(), r_sig = Fp::getRand();
-    stream << (priv.i1 * u2 + r_rho * v2);
-    stream << (priv.i2 * u1 + r_sig * v1);
-    stream << (-r_rho) * v1;
-    stream << (-r_sig) * v2;
+    genPrivateMany(stream, 1, &priv);
     return priv;
 }
 
 bool CRS::checkPrivate(std::istream &stream, CRS priv) const {
-    if ((v1 != priv.v1) || (v2 != priv.v2))
-        return false;
-    G2 c_rho_1, c_rho_2, p3, p4, g2;
-    G1 c_sig_1, c_sig_2, p1, p2, g1;
-    stream >> c_rho_1 >> c_rho_2;
-    stream >> c_sig_1 >> c_sig_2;
-    stream >> p1 >> p2 >> p3 >> p4;
-    Fp c1_1 = Fp::getRand(), c1_2 = Fp::getRand();
-    Fp c2_1 = Fp::getRand(), c2_2 = Fp::getRand();
+    return checkPrivateMany(stream, &priv, 1);
+}
+
+void CRS::genPrivateMany(std::ostream &stream, size_t n, CRS *privs,
+                         int threads) const {
+    if (type != CRS_TYPE_PUBLIC)
+        throw "Unexpected use of gsnizk::genPrivate";
+    std::vector<Fp> rnd(4 * n);
+    Fp::getRandMany(rnd.data(), 4 * n);
+    Fp *rho = rnd.data(), *sig = rho + n, *r_rho = sig + n, *r_sig = r_rho + n;
+    for (size_t k = 0; k < n; ++k) {
+        CRS &priv = privs[k];
+        priv.type = CRS_TYPE_PRIVATE;
+        priv.v1 = v1;
+        priv.i1 = rho[k];
+        priv.v2 = v2;
+        priv.i2 = sig[k];
+        priv.computeElements(false);
+    }
+    std::vector<B1> c_sig(n), p_rho(n);
+    std::vector<B2> c_rho(n), p_sig(n);
+    B2::commitMany(rho, r_rho, n, *this, c_rho.data(), threads);
+    B1::commitMany(sig, r_sig, n, *this, c_sig.data(), threads);
+    /* (-r_rho) v1 and (-r_sig) v2, as half-commitments of zero */
+    for (size_t k = 0; k < n; ++k) {
+        r_rho[k] = -r_rho[k];
+        r_sig[k] = -r_sig[k];
+    }
+    B1::commitMany(p_rho.data(), r_rho, NULL, n, *this, p_rho.data(),
+                   threads);
+    B2::commitMany(p_sig.data(), r_sig, NULL, n, *this, p_sig.data(),
+                   threads);
+    for (size_t k = 0; k < n; ++k) {
+        stream << c_rho[k];
+        stream << c_sig[k];
+        stream << p_rho[k];
+        stream << p_sig[k];
+    }
+}
+
+bool CRS::checkPrivateMany(std::istream &stream, const CRS *privs,
+                           size_t n) const {
+    /* Each proof consists of two equations in B_T. As in the original
+     * check, rows and columns are combined with (1, a) and (1, b), and
+     * the two equations of the k-th proof are weighted with the short
+     * scalars d[k] and e[k]. Since most of the elements are then shared,
+     * the whole batch is a product of four pairings. */
+    std::vector<ShortScalar> coeffs(2 * n);
+    ShortScalar::getRandMany(coeffs.data(), 2 * n);
+    const ShortScalar *d = coeffs.data(), *e = d + n;
+    /* p_k[i] and r_k[i] are weighted with d[i] for i < n and
+     * with e[i - n] otherwise */
+    std::vector<G1> w1_1(n), w1_2(n), p_1(2 * n), p_2(2 * n);
+    std::vector<G2> w2_1(n), w2_2(n), r_1(2 * n), r_2(2 * n);
+    for (size_t k = 0; k < n; ++k) {
+        const CRS &priv = privs[k];
+        if ((v1 != priv.v1) || (v2 != priv.v2))
+            return false;
+        stream >> r_1[k] >> r_2[k];
+        stream >> p_1[n + k] >> p_2[n + k];
+        stream >> p_1[k] >> p_2[k] >> r_1[n + k] >> r_2[n + k];
+        w1_1[k] = priv.w1._1;
+        w1_2[k] = priv.w1._2;
+        w2_1[k] = priv.w2._1;
+        w2_2[k] = priv.w2._2;
+    }
+    ShortScalar a = ShortScalar::getRand(), b = ShortScalar::getRand();
     std::vector< std::pair<G1,G2> > pairs;
-    pairs.reserve(3);
-    g1 = -(c1_1 * priv.w1._1 + c1_2 * priv.w1._2);
-    g2 = c2_1 * u2._1 + c2_2 * u2._2;
-    pairs.push_back(std::pair<G1,G2>(g1, g2));
-    g1 = c1_1 * v1._1 + c1_2 * v1._2;
-    g2 = c2_1 * c_rho_1 + c2_2 * c_rho_2;
-    pairs.push_back(std::pair<G1,G2>(g1, g2));
-    g1 = c1_1 * p1 + c1_2 * p2;
-    g2 = c2_1 * v2._1 + c2_2 * v2._2;
-    pairs.push_back(std::pair<G1,G2>(g1, g2));
-    if (!GT::pairing(pairs).isUnit())
-        return false;
-    pairs.clear();
-    c1_1 = Fp::getRand(); c1_2 = Fp::getRand();
-    c2_1 = Fp::getRand(); c2_2 = Fp::getRand();
-    g1 = -(c1_1 * u1._1 + c1_2 * u1._2);
-    g2 = c2_1 * priv.w2._1 + c2_2 * priv.w2._2;
-    pairs.push_back(std::pair<G1,G2>(g1, g2));
-    g1 = c1_1 * c_sig_1 + c1_2 * c_sig_2;
-    g2 = c2_1 * v2._1 + c2_2 * v2._2;
-    pairs.push_back(std::pair<G1,G2>(g1, g2));
-    g1 = c1_1 * v1._1 + c1_2 * v1._2;
-    g2 = c2_1 * p3 + c2_2 * p4;
-    pairs.push_back(std::pair<G1,G2>(g1, g2));
-    if (!GT::pairing(pairs).isUnit())
-        return false;
-    return true;
+    pairs.reserve(4);
+    pairs.push_back(std::pair<G1,G2>(
+            -(G1::mulSum(w1_1.data(), d, n) +
+              a * G1::mulSum(w1_2.data(), d, n)),
+            u2._1 + b * u2._2));
+    pairs.push_back(std::pair<G1,G2>(
+            v1._1 + a * v1._2,
+            G2::mulSum(r_1.data(), d, 2 * n) +
+            b * G2::mulSum(r_2.data(), d, 2 * n)));
+    pairs.push_back(std::pair<G1,G2>(
+            G1::mulSum(p_1.data(), d, 2 * n) +
+            a * G1::mulSum(p_2.data(), d, 2 * n),
+            v2._1 + b * v2._2));
+    pairs.push_back(std::pair<G1,G2>(
+            -(u1._1 + a * u1._2),
+            G2::mulSum(w2_1.data(), e, n) +
+            b * G2::mulSum(w2_2.data(), e, n)));
+    return GT::pairing(pairs).isUnit();
 }
 
 std::ostream &operator<<(std::ostream &stream, const CRS &crs) {
@@ -204,6 +415,7 @@ std::istream &operator>>(std::istream &stream, CRS &crs) {
         crs.v2._2.precomputeForPairing();
         crs.w2._2.precomputeForPairing();
 #endif
+        crs.computeTables();
     } else if (crs.type == CRS_TYPE_PRIVATE) {
         stream >> crs.v1 >> crs.v2;
         stream >> crs.i1 >> crs.i2;
@@ -245,6 +457,11 @@ void CRS::computeElements(bool precompute_v) {
     } else {
         v1._1 = j1 * v1._2;
         v2._1 = j2 * v2._2;
+        if (type == CRS_TYPE_EXTRACT) {
+            /* Inverses for the extraction of committed values */
+            ij1 = Fp::getUnit() / j1;
+            ij2 = Fp::getUnit() / j2;
+        }
 #if !defined(USE_PBC)
         /* Precomputations for commitments */
         v1._1.precomputeForMult();
@@ -282,6 +499,42 @@ void CRS::computeElements(bool precompute_v) {
     v2._2.precomputeForPairing();
     w2._2.precomputeForPairing();
 #endif
+    computeTables();
+}
+
+void CRS::computeTables() {
+    uv1[0] = pairings::G1JointTable(u1._1, v1._1);
+    uv1[1] = pairings::G1JointTable(u1._2, v1._2);
+    uv2[0] = pairings::G2JointTable(u2._1, v2._1);
+    uv2[1] = pairings::G2JointTable(u2._2, v2._2);
+    if (type & 1) {
+        /* w is a known multiple of v (see CRS::combine) */
+        vw1[0] = vw1[1] = pairings::G1JointTable();
+        vw2[0] = vw2[1] = pairings::G2JointTable();
+    } else {
+        vw1[0] = pairings::G1JointTable(v1._1, w1._1);
+        vw1[1] = pairings::G1JointTable(v1._2, w1._2);
+        vw2[0] = pairings::G2JointTable(v2._1, w2._1);
+        vw2[1] = pairings::G2JointTable(v2._2, w2._2);
+    }
+}
+
+template <>
+B1 CRS::combine<B1>(const Fp &r, const Fp &s) const {
+    if (type & 1)
+        return (r + i1 * s) * v1;
+    if (vw1[0].isNull())
+        return r * v1 + s * w1;
+    return B1(vw1[0].mult(r, s), vw1[1].mult(r, s));
+}
+
+template <>
+B2 CRS::combine<B2>(const Fp &r, const Fp &s) const {
+    if (type & 1)
+        return (r + i2 * s) * v2;
+    if (vw2[0].isNull())
+        return r * v2 + s * w2;
+    return B2(vw2[0].mult(r, s), vw2[1].mult(r, s));
 }
 
 } /* End of namespace nizk */
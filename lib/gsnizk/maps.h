@@ -101,6 +101,14 @@ inline bool iostream_nothreads();
  */
 typedef pairings::Fp Fp;
 
+/**
+ * @brief Short scalars, for the coefficients of random linear combinations.
+ *
+ * This is a `typedef` extension of @ref pairings 's definition.
+ * @sa pairings::ShortScalar
+ */
+typedef pairings::ShortScalar ShortScalar;
+
 /**
  * @brief The @f$\mathbb{G}_1@f$ class.
  *
@@ -205,6 +213,37 @@ public:
      * @return Product @f$m\cdot g@f$
      */
     inline friend B1 operator*(const Fp &m, const B1 &g);
+    /**
+     * @brief Inplace multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return Reference to the modified element.
+     */
+    inline B1 &operator*=(const ShortScalar &other);
+    /**
+     * @brief Multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return The product of the two elements.
+     */
+    inline B1 operator*(const ShortScalar &other) const;
+    /**
+     * @brief Multiplication operator.
+     * @param m Short scalar value.
+     * @param g Element value.
+     * @return Product @f$m\cdot g@f$
+     */
+    inline friend B1 operator*(const ShortScalar &m, const B1 &g);
+    /**
+     * @brief Computes a linear combination with short scalars.
+     *
+     * Both coordinates are computed with pairings::G1::mulSum, so that
+     * all the terms share the same doublings.
+     *
+     * @param els Array of @p n elements.
+     * @param m Array of @p n short scalars.
+     * @param n Number of terms.
+     * @return The sum @f$\sum_i m_i\cdot els_i@f$.
+     */
+    static B1 mulSum(const B1 *els, const ShortScalar *m, size_t n);
     /**
      * @brief Equality operator.
      * @param other Value with which to compare the current element.
@@ -233,6 +272,41 @@ public:
      * @sa operator<<(std::istream&,const B1&)
      */
     inline friend std::istream &operator>>(std::istream &stream, B1 &el);
+    /**
+     * @brief Retrieves this element's data.
+     *
+     * The data holds the data of both components, as given by
+     * @ref G1::getData(char*,bool), and always contains exactly the
+     * number of bytes returned by the @ref B1::getDataLen(bool)
+     * function called with the same @p compressed value.
+     *
+     * @note Uncompressed data is almost twice bigger, but it is faster
+     * to reconstruct in the @ref B1::getValue(const char*,bool)
+     * function, since no square root is needed.
+     *
+     * @param data Pointer to where the data is to be stored.
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
+     * @sa B1::getDataLen(bool)
+     * @sa B1::getValue(const char*,bool)
+     */
+    inline void getData(char *data, bool compressed = false) const;
+    /**
+     * @brief Gets the length of an element's data.
+     * @param compressed Whether the data is compressed or not.
+     * @return The length of the data, in bytes.
+     * @sa B1::getData(char*,bool)
+     */
+    inline static int getDataLen(bool compressed = false);
+    /**
+     * @brief Gets an element value from its data.
+     * @param data Pointer to the data, as given by
+     *   @ref B1::getData(char*,bool).
+     * @param compressed Whether the data was compressed or not.
+     * @return The element value corresponding to that data.
+     * @sa B1::getData(char*,bool)
+     */
+    inline static B1 getValue(const char *data, bool compressed = false);
     /**
      * @brief Extracts the value in @f$\mathbb{G}_1@f$ that this
      *   commitment refers to.
@@ -243,6 +317,23 @@ public:
      * @return Value in @f$\mathbb{G}_1@f$ that this commitment refers to.
      */
     G1 extract(const CRS &crs) const;
+    /**
+     * @brief Extracts the values that several commitments refer to.
+     *
+     * Sets @p out[i] to the value of @p els[i].extract(crs). The
+     * scalars that depend on the CRS are applied to all the elements
+     * at once (see pairings::G1::mulMany).
+     *
+     * @param els The commitments.
+     * @param n Number of commitments.
+     * @param crs CRS with information on the binding key.
+     * @param out Array of @p n elements where the values in
+     *   @f$\mathbb{G}_1@f$ are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it.
+     */
+    static void extractMany(const B1 *els, size_t n, const CRS &crs,
+                            G1 *out, int threads = 1);
     /**
      * @brief Commits to an element @a el with randomness @a r.
      * @param el The element in @f$\mathbb{F}_p@f$ to commit to.
@@ -293,6 +384,48 @@ public:
      * @return The committed element.
      */
     static B1 commit(const B1 &el, const Fp &r, const Fp &s, const CRS &crs);
+    /**
+     * @brief Commits to several elements at once.
+     *
+     * Sets @p out[i] to the value of
+     * @ref B1::commit(const Fp&,const Fp&,const CRS&) "commit(els[i], r[i], crs)",
+     * evaluating all of them with the precomputed tables of the CRS.
+     *
+     * @param els The elements in @f$\mathbb{F}_p@f$ to commit to.
+     * @param r The randomness values.
+     * @param n Number of elements.
+     * @param crs The Common Reference String that is to be used
+     *   for these commits.
+     * @param out Array of @p n elements where the commitments are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see pairings::G1JointTable::multMany).
+     */
+    static void commitMany(const Fp *els, const Fp *r, size_t n,
+                           const CRS &crs, B1 *out, int threads = 1);
+    /**
+     * @brief Commits to several converted elements at once.
+     *
+     * Sets @p out[i] to the value of
+     * @ref B1::commit(const B1&,const Fp&,const Fp&,const CRS&) "commit(els[i], r[i], s[i], crs)",
+     * evaluating all of them with the precomputed tables of the CRS.
+     * Half-commitments are obtained with a null @p s, or with
+     * @p s[i] set to zero for some of the elements only.
+     *
+     * @param els The converted elements in @f$\mathbb{B}_1@f$
+     *   to commit to.
+     * @param r The first randomness values.
+     * @param s The second randomness values, or `NULL`.
+     * @param n Number of elements.
+     * @param crs The Common Reference String that is to be used
+     *   for these commits.
+     * @param out Array of @p n elements where the commitments are stored.
+     *   It may be the same as @p els.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see pairings::G1JointTable::multMany).
+     */
+    static void commitMany(const B1 *els, const Fp *r, const Fp *s,
+                           size_t n, const CRS &crs, B1 *out,
+                           int threads = 1);
 public:
     G1 _1, _2;
 };
@@ -375,6 +508,37 @@ public:
      * @return Product @f$m\cdot g@f$
      */
     inline friend B2 operator*(const Fp &m, const B2 &g);
+    /**
+     * @brief Inplace multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return Reference to the modified element.
+     */
+    inline B2 &operator*=(const ShortScalar &other);
+    /**
+     * @brief Multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return The product of the two elements.
+     */
+    inline B2 operator*(const ShortScalar &other) const;
+    /**
+     * @brief Multiplication operator.
+     * @param m Short scalar value.
+     * @param g Element value.
+     * @return Product @f$m\cdot g@f$
+     */
+    inline friend B2 operator*(const ShortScalar &m, const B2 &g);
+    /**
+     * @brief Computes a linear combination with short scalars.
+     *
+     * Both coordinates are computed with pairings::G2::mulSum, so that
+     * all the terms share the same doublings.
+     *
+     * @param els Array of @p n elements.
+     * @param m Array of @p n short scalars.
+     * @param n Number of terms.
+     * @return The sum @f$\sum_i m_i\cdot els_i@f$.
+     */
+    static B2 mulSum(const B2 *els, const ShortScalar *m, size_t n);
     /**
      * @brief Equality operator.
      * @param other Value with which to compare the current element.
@@ -403,6 +567,41 @@ public:
      * @sa operator<<(std::istream&,const B2&)
      */
     inline friend std::istream &operator>>(std::istream &stream, B2 &el);
+    /**
+     * @brief Retrieves this element's data.
+     *
+     * The data holds the data of both components, as given by
+     * @ref G2::getData(char*,bool), and always contains exactly the
+     * number of bytes returned by the @ref B2::getDataLen(bool)
+     * function called with the same @p compressed value.
+     *
+     * @note Uncompressed data is almost twice bigger, but it is faster
+     * to reconstruct in the @ref B2::getValue(const char*,bool)
+     * function, since no square root is needed.
+     *
+     * @param data Pointer to where the data is to be stored.
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
+     * @sa B2::getDataLen(bool)
+     * @sa B2::getValue(const char*,bool)
+     */
+    inline void getData(char *data, bool compressed = false) const;
+    /**
+     * @brief Gets the length of an element's data.
+     * @param compressed Whether the data is compressed or not.
+     * @return The length of the data, in bytes.
+     * @sa B2::getData(char*,bool)
+     */
+    inline static int getDataLen(bool compressed = false);
+    /**
+     * @brief Gets an element value from its data.
+     * @param data Pointer to the data, as given by
+     *   @ref B2::getData(char*,bool).
+     * @param compressed Whether the data was compressed or not.
+     * @return The element value corresponding to that data.
+     * @sa B2::getData(char*,bool)
+     */
+    inline static B2 getValue(const char *data, bool compressed = false);
     /**
      * @brief Extracts the value in @f$\mathbb{G}_2@f$ that this
      *   commitment refers to.
@@ -413,6 +612,23 @@ public:
      * @return Value in @f$\mathbb{G}_2@f$ that this commitment refers to.
      */
     G2 extract(const CRS &crs) const;
+    /**
+     * @brief Extracts the values that several commitments refer to.
+     *
+     * Sets @p out[i] to the value of @p els[i].extract(crs). The
+     * scalars that depend on the CRS are applied to all the elements
+     * at once (see pairings::G2::mulMany).
+     *
+     * @param els The commitments.
+     * @param n Number of commitments.
+     * @param crs CRS with information on the binding key.
+     * @param out Array of @p n elements where the values in
+     *   @f$\mathbb{G}_2@f$ are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it.
+     */
+    static void extractMany(const B2 *els, size_t n, const CRS &crs,
+                            G2 *out, int threads = 1);
     /**
      * @brief Commits to an element @a el with randomness @a r.
      * @param el The element in @f$\mathbb{F}_p@f$ to commit to.
@@ -463,6 +679,48 @@ public:
      * @return The committed element.
      */
     static B2 commit(const B2 &el, const Fp &r, const Fp &s, const CRS &crs);
+    /**
+     * @brief Commits to several elements at once.
+     *
+     * Sets @p out[i] to the value of
+     * @ref B2::commit(const Fp&,const Fp&,const CRS&) "commit(els[i], r[i], crs)",
+     * evaluating all of them with the precomputed tables of the CRS.
+     *
+     * @param els The elements in @f$\mathbb{F}_p@f$ to commit to.
+     * @param r The randomness values.
+     * @param n Number of elements.
+     * @param crs The Common Reference String that is to be used
+     *   for these commits.
+     * @param out Array of @p n elements where the commitments are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see pairings::G2JointTable::multMany).
+     */
+    static void commitMany(const Fp *els, const Fp *r, size_t n,
+                           const CRS &crs, B2 *out, int threads = 1);
+    /**
+     * @brief Commits to several converted elements at once.
+     *
+     * Sets @p out[i] to the value of
+     * @ref B2::commit(const B2&,const Fp&,const Fp&,const CRS&) "commit(els[i], r[i], s[i], crs)",
+     * evaluating all of them with the precomputed tables of the CRS.
+     * Half-commitments are obtained with a null @p s, or with
+     * @p s[i] set to zero for some of the elements only.
+     *
+     * @param els The converted elements in @f$\mathbb{B}_2@f$
+     *   to commit to.
+     * @param r The first randomness values.
+     * @param s The second randomness values, or `NULL`.
+     * @param n Number of elements.
+     * @param crs The Common Reference String that is to be used
+     *   for these commits.
+     * @param out Array of @p n elements where the commitments are stored.
+     *   It may be the same as @p els.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see pairings::G2JointTable::multMany).
+     */
+    static void commitMany(const B2 *els, const Fp *r, const Fp *s,
+                           size_t n, const CRS &crs, B2 *out,
+                           int threads = 1);
 public:
     G2 _1, _2;
 };
@@ -551,6 +809,30 @@ public:
      * @return Power @f$this^{other}@f$
      */
     inline BT operator^(const Fp &other) const;
+    /**
+     * @brief Inplace power operator.
+     * @param other Short exponent value.
+     * @return Reference to the modified element.
+     */
+    inline BT &operator^=(const ShortScalar &other);
+    /**
+     * @brief Power operator.
+     * @param other Short exponent value.
+     * @return Power @f$this^{other}@f$
+     */
+    inline BT operator^(const ShortScalar &other) const;
+    /**
+     * @brief Computes a product of powers with short exponents.
+     *
+     * All four coordinates are computed with pairings::GT::powProd, so
+     * that all the factors share the same squarings.
+     *
+     * @param els Array of @p n elements.
+     * @param m Array of @p n short exponents.
+     * @param n Number of factors.
+     * @return The product @f$\prod_i els_i^{m_i}@f$.
+     */
+    static BT powProd(const BT *els, const ShortScalar *m, size_t n);
     /**
      * @brief Equality operator.
      * @param other Value with which to compare the current element.
@@ -579,6 +861,43 @@ public:
      * @sa operator<<(std::istream&,const BT&)
      */
     inline friend std::istream &operator>>(std::istream &stream, BT &el);
+    /**
+     * @brief Retrieves this element's data.
+     *
+     * The data is the concatenation of the data of the four
+     * coordinates, as given by @ref GT::getData(char*,bool), and always
+     * contains exactly the number of bytes returned by the
+     * @ref BT::getDataLen(bool) function called with the same
+     * @p compressed value.
+     *
+     * @note Compressed data is twice smaller, which makes it the
+     * better choice to store or send commitments in
+     * @f$\mathbb{B}_T@f$; it is only available if
+     * pairings::hasGTCompression() returns `true`.
+     *
+     * @param data Pointer to where the data is to be stored.
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
+     * @sa BT::getDataLen(bool)
+     * @sa BT::getValue(const char*,bool)
+     */
+    inline void getData(char *data, bool compressed = false) const;
+    /**
+     * @brief Gets the length of an element's data.
+     * @param compressed Whether the data is compressed or not.
+     * @return The length of the data, in bytes.
+     * @sa BT::getData(char*,bool)
+     */
+    inline static int getDataLen(bool compressed = false);
+    /**
+     * @brief Gets an element value from its data.
+     * @param data Pointer to the data, as given by
+     *   @ref BT::getData(char*,bool).
+     * @param compressed Whether the data was compressed or not.
+     * @return The element value corresponding to that data.
+     * @sa BT::getData(char*,bool)
+     */
+    inline static BT getValue(const char *data, bool compressed = false);
     /**
      * @brief Extracts the value that this commitment refers to,
      *   as an element of @f$\mathbb{G}_T@f$.
@@ -586,6 +905,23 @@ public:
      * @return Value in @f$\mathbb{G}_T@f$ that this commitment refers to.
      */
     GT extract(const CRS &crs) const;
+    /**
+     * @brief Extracts the values that several commitments refer to.
+     *
+     * Sets @p out[i] to the value of @p els[i].extract(crs). The
+     * scalars that depend on the CRS are applied to all the elements
+     * at once (see pairings::GT::powMany).
+     *
+     * @param els The commitments.
+     * @param n Number of commitments.
+     * @param crs CRS with information on the binding key.
+     * @param out Array of @p n elements where the values in
+     *   @f$\mathbb{G}_T@f$ are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it.
+     */
+    static void extractMany(const BT *els, size_t n, const CRS &crs,
+                            GT *out, int threads = 1);
 public:
     /**
      * @brief Computes a pairing of two elements.
@@ -676,6 +1012,38 @@ public:
      * @return `true` if the proof is correct, `false` otherwise.
      */
     bool checkPrivate(std::istream &stream, CRS priv) const;
+    /**
+     * @brief Generates several private CRS from this public CRS.
+     *
+     * This is equivalent to calling genPrivate(std::ostream&) @p n times,
+     * with the proofs written one after the other in @p stream,
+     * but all the commitments are computed in batches
+     * (see B1::commitMany and B2::commitMany).
+     *
+     * @param stream Output stream to which the proofs that the private
+     *   CRS are well-formed will be written.
+     * @param n Number of private CRS to generate.
+     * @param privs Array of @p n CRS where the private CRS are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it.
+     */
+    void genPrivateMany(std::ostream &stream, size_t n, CRS *privs,
+                        int threads = 1) const;
+    /**
+     * @brief Checks the proofs that several private CRS have been
+     *   correctly generated.
+     *
+     * The equations of all the proofs are merged into a single product
+     * of pairings, with short random exponents.
+     *
+     * @param stream Input stream from which the proofs will be read,
+     *   as written by genPrivateMany(std::ostream&,size_t,CRS*,int).
+     * @param privs The private CRS to check.
+     * @param n Number of private CRS.
+     * @return `true` if all the proofs are correct, `false` otherwise.
+     */
+    bool checkPrivateMany(std::istream &stream, const CRS *privs,
+                          size_t n) const;
     /**
      * @brief Writes this CRS to an output stream.
      * @param stream Output stream.
@@ -722,8 +1090,25 @@ public:
      * @return `true` if yes, `false` otherwise.
      */
     inline bool isSimulationReady() const;
+    /**
+     * @brief Computes a linear combination of the second and third
+     *   elements of this CRS.
+     *
+     * With the notations of Escala and Groth, this is
+     * @f$r\cdot v_1+s\cdot w_1@f$ for `B = B1` and
+     * @f$r\cdot v_2+s\cdot w_2@f$ for `B = B2`. Both terms are
+     * evaluated in a single pass over precomputed joint tables.
+     *
+     * @tparam B Either B1 or B2.
+     * @param r Scalar for the @f$v@f$ element.
+     * @param s Scalar for the @f$w@f$ element.
+     * @return The linear combination.
+     */
+    template <class B>
+    B combine(const Fp &r, const Fp &s) const;
 private:
     void computeElements(bool precompute_v = true);
+    void computeTables();
 private:
     /* Notations u, v and w come from the paper by Alex Escala
      * and Jens Groth.
@@ -735,13 +1120,35 @@ private:
      * type==CRS_TYPE_PRIVATE:
      *   Only i1 and i2 are available; they stand for rho_P
      *   and sigma_P in Escala's paper.
+     * ij1 and ij2 are the inverses of j1 and j2, only kept
+     * for type==CRS_TYPE_EXTRACT (extraction).
      */
     B1 u1, v1, w1;
     B2 u2, v2, w2;
     int type;
     Fp i1, j1, i2, j2;
+    Fp ij1, ij2;
+    /* Joint tables of the pairs (u,v) and (v,w), one for each component.
+     * The (v,w) ones are only built when w is not a known multiple of v,
+     * that is for CRS_TYPE_PUBLIC and CRS_TYPE_ZK. */
+    pairings::G1JointTable uv1[2], vw1[2];
+    pairings::G2JointTable uv2[2], vw2[2];
 };
 
+/**
+ * @cond INTERNAL_DATA_STRUCT
+ */
+
+template <>
+B1 CRS::combine<B1>(const Fp &r, const Fp &s) const;
+
+template <>
+B2 CRS::combine<B2>(const Fp &r, const Fp &s) const;
+
+/**
+ * @endcond
+ */
+
 /* Inline definitions: */
 
 inline void initialize_pairings(int len, const char *data) {
@@ -802,17 +1209,45 @@ inline B1 &B1::operator-=(const B1 &other) {
 }
 
 inline B1 &B1::operator*=(const Fp &other) {
+#if defined(USE_PBC)
+    // Note: With PBC, both coordinates share the GLV split of the scalar
+    G1 els[2] = { _1, _2 };
+    G1::mulMany(els, 2, other, els);
+    _1 = els[0];
+    _2 = els[1];
+#else
     _1 *= other;
     _2 *= other;
+#endif
     return *this;
 }
 
 inline B1 B1::operator*(const Fp &other) const {
-    return B1(other * _1, other * _2);
+#if defined(USE_PBC)
+    G1 els[2] = { _1, _2 };
+    G1::mulMany(els, 2, other, els);
+    return B1(els[0], els[1]);
+#else
+    return B1(_1 * other, _2 * other);
+#endif
 }
 
 inline B1 operator*(const Fp &m, const B1 &g) {
-    return B1(m * g._1, m * g._2);
+    return g * m;
+}
+
+inline B1 &B1::operator*=(const ShortScalar &other) {
+    _1 *= other;
+    _2 *= other;
+    return *this;
+}
+
+inline B1 B1::operator*(const ShortScalar &other) const {
+    return B1(_1 * other, _2 * other);
+}
+
+inline B1 operator*(const ShortScalar &m, const B1 &g) {
+    return g * m;
 }
 
 inline bool B1::operator==(const B1 &other) const {
@@ -833,6 +1268,20 @@ inline std::istream &operator>>(std::istream &stream, B1 &el) {
     return stream;
 }
 
+inline void B1::getData(char *data, bool compressed) const {
+    _1.getData(data, compressed);
+    _2.getData(data + G1::getDataLen(compressed), compressed);
+}
+
+inline int B1::getDataLen(bool compressed) {
+    return G1::getDataLen(compressed) << 1;
+}
+
+inline B1 B1::getValue(const char *data, bool compressed) {
+    return B1(G1::getValue(data, compressed),
+              G1::getValue(data + G1::getDataLen(compressed), compressed));
+}
+
 inline B1 B1::commit(const G1 &el, const Fp &r, const CRS &crs) {
     return B1::commit(B1(el), r, crs);
 }
@@ -888,6 +1337,20 @@ inline B2 operator*(const Fp &m, const B2 &g) {
     return B2(m * g._1, m * g._2);
 }
 
+inline B2 &B2::operator*=(const ShortScalar &other) {
+    _1 *= other;
+    _2 *= other;
+    return *this;
+}
+
+inline B2 B2::operator*(const ShortScalar &other) const {
+    return B2(_1 * other, _2 * other);
+}
+
+inline B2 operator*(const ShortScalar &m, const B2 &g) {
+    return g * m;
+}
+
 inline bool B2::operator==(const B2 &other) const {
     return (_1 == other._1) && (_2 == other._2);
 }
@@ -906,6 +1369,20 @@ inline std::istream &operator>>(std::istream &stream, B2 &el) {
     return stream;
 }
 
+inline void B2::getData(char *data, bool compressed) const {
+    _1.getData(data, compressed);
+    _2.getData(data + G2::getDataLen(compressed), compressed);
+}
+
+inline int B2::getDataLen(bool compressed) {
+    return G2::getDataLen(compressed) << 1;
+}
+
+inline B2 B2::getValue(const char *data, bool compressed) {
+    return B2(G2::getValue(data, compressed),
+              G2::getValue(data + G2::getDataLen(compressed), compressed));
+}
+
 inline B2 B2::commit(const G2 &el, const Fp &r, const CRS &crs) {
     return B2::commit(B2(el), r, crs);
 }
@@ -957,6 +1434,30 @@ inline BT &BT::operator/=(const BT &other) {
     return *this;
 }
 
+inline BT &BT::operator^=(const Fp &other) {
+    _11 ^= other;
+    _12 ^= other;
+    _21 ^= other;
+    _22 ^= other;
+    return *this;
+}
+
+inline BT BT::operator^(const Fp &other) const {
+    return BT(_11 ^ other, _12 ^ other, _21 ^ other, _22 ^ other);
+}
+
+inline BT &BT::operator^=(const ShortScalar &other) {
+    _11 ^= other;
+    _12 ^= other;
+    _21 ^= other;
+    _22 ^= other;
+    return *this;
+}
+
+inline BT BT::operator^(const ShortScalar &other) const {
+    return BT(_11 ^ other, _12 ^ other, _21 ^ other, _22 ^ other);
+}
+
 inline bool BT::operator==(const BT &other) const {
     return (_11 == other._11) && (_12 == other._12) &&
             (_21 == other._21) && (_22 == other._22);
@@ -979,6 +1480,26 @@ inline std::istream &operator>>(std::istream &stream, BT &el) {
     return stream;
 }
 
+inline void BT::getData(char *data, bool compressed) const {
+    int len = GT::getDataLen(compressed);
+    _11.getData(data, compressed);
+    _12.getData(data + len, compressed);
+    _21.getData(data + 2 * len, compressed);
+    _22.getData(data + 3 * len, compressed);
+}
+
+inline int BT::getDataLen(bool compressed) {
+    return GT::getDataLen(compressed) << 2;
+}
+
+inline BT BT::getValue(const char *data, bool compressed) {
+    int len = GT::getDataLen(compressed);
+    return BT(GT::getValue(data, compressed),
+              GT::getValue(data + len, compressed),
+              GT::getValue(data + 2 * len, compressed),
+              GT::getValue(data + 3 * len, compressed));
+}
+
 inline CRS::CRS() {}
 
 inline G1 CRS::getG1Base() const { return v1._2; }
@@ -40,10 +40,286 @@
 //#define HASH_LEN_BITS 512
 #endif
 
-#define NULL_ELEMENT_BYTE_VALUE 2
-
 #define HASH_LEN_BYTES (HASH_LEN_BITS / 8)
 
+/* Window size, in bits, for the linear combinations with short scalars
+ * (see G1::mulSum); 2 is the best choice for 64-bit scalars */
+#define SHORT_WINDOW 2
+
+#include <cstring>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "chacha20.h"
+
+#if HASH_LEN_BITS == 256
+#include "sha256.h"
+#define HASH_CTX sha256_ctx
+#define HASH_INIT sha256_init
+#define HASH_UPDATE sha256_update
+#define HASH_FINAL sha256_final
+#define HASH_MANY hash_sha256_many
+#elif HASH_LEN_BITS == 512
+#include "sha512.h"
+#define HASH_CTX sha512_ctx
+#define HASH_INIT sha512_init
+#define HASH_UPDATE sha512_update
+#define HASH_FINAL sha512_final
+#define HASH_MANY hash_sha512_many
+#else
+#error Error: Invalid value of HASH_LEN_BITS (pairings)
+#endif
+
+namespace pairings {
+
+static_assert(sizeof(HASH_CTX) <= sizeof(HashContext),
+              "HashContext is too small for the hash state");
+
+int getHashLen() {
+    return HASH_LEN_BYTES;
+}
+
+void getHash(const char *data, int len, char *hash) {
+    HASH_CTX ctx;
+    HASH_INIT(&ctx);
+    HASH_UPDATE(&ctx, data, len);
+    HASH_FINAL(&ctx, hash);
+}
+
+void getHashMany(const char **data, const int *len, int n, char *hash) {
+    HASH_MANY(data, len, n, hash);
+}
+
+void hashInit(HashContext &ctx) {
+    HASH_INIT(reinterpret_cast<HASH_CTX*>(ctx.data));
+}
+
+void hashUpdate(HashContext &ctx, const char *data, int len) {
+    HASH_UPDATE(reinterpret_cast<HASH_CTX*>(ctx.data), data, len);
+}
+
+void hashFinal(HashContext &ctx, char *hash) {
+    HASH_FINAL(reinterpret_cast<HASH_CTX*>(ctx.data), hash);
+}
+
+/* Number of ChaCha20 blocks generated at once */
+#define RANDOM_BUFFER_BLOCKS 16
+
+/* Buffered ChaCha20 generator; the first 32 bytes of each refill become
+ * the next key, so that past outputs cannot be recovered from the state */
+struct RandomState {
+    bool seeded;
+    uint32_t key[8];
+    size_t pos;
+    unsigned char buf[RANDOM_BUFFER_BLOCKS * 64];
+};
+
+static thread_local RandomState rng;
+
+static void seedRandom(const uint32_t *key) {
+    memcpy(rng.key, key, 32);
+    rng.pos = sizeof(rng.buf);
+    rng.seeded = true;
+}
+
+void setRandomSeed(const char *seed, int len) {
+    ASSERT(len >= 0, "Negative length");
+    char hash[HASH_LEN_BYTES];
+    uint32_t key[8];
+    getHash(seed, len, hash);
+    memcpy(key, hash, 32);
+    seedRandom(key);
+}
+
+void randomBytes(unsigned char *out, size_t len) {
+    if (UNLIKELY(!rng.seeded)) {
+        std::random_device device;
+        uint32_t key[8];
+        for (int i = 0; i < 8; ++i)
+            key[i] = (uint32_t) device();
+        seedRandom(key);
+    }
+    while (len) {
+        if (rng.pos == sizeof(rng.buf)) {
+            chacha20_blocks(rng.key, 0, 0, rng.buf, RANDOM_BUFFER_BLOCKS);
+            memcpy(rng.key, rng.buf, 32);
+            rng.pos = 32;
+        }
+        size_t n = sizeof(rng.buf) - rng.pos;
+        if (n > len) n = len;
+        memcpy(out, rng.buf + rng.pos, n);
+        memset(rng.buf + rng.pos, 0, n);
+        rng.pos += n;
+        out += n;
+        len -= n;
+    }
+}
+
+/* Cache of decompressed points, indexed by their compressed data, with
+ * the most recently used ones at the beginning of the list */
+template <class T> class PointCache {
+public:
+    inline PointCache() : capacity(0) {}
+    bool find(const char *data, int len, T &el);
+    void insert(const char *data, int len, const T &el);
+    void setCapacity(size_t capacity);
+    inline void clear();
+private:
+    typedef std::pair<std::string,T> Entry;
+    size_t capacity;
+    std::list<Entry> entries;
+    std::unordered_map<std::string,
+                       typename std::list<Entry>::iterator> index;
+};
+
+template <class T>
+bool PointCache<T>::find(const char *data, int len, T &el) {
+    if (!capacity) return false;
+    auto it = index.find(std::string(data, len));
+    if (it == index.end()) return false;
+    entries.splice(entries.begin(), entries, it->second);
+    el = it->second->second;
+    return true;
+}
+
+template <class T>
+void PointCache<T>::insert(const char *data, int len, const T &el) {
+    if (!capacity) return;
+    std::string key(data, len);
+    if (index.count(key)) return;
+    entries.push_front(Entry(key, el));
+    index[key] = entries.begin();
+    setCapacity(capacity);
+}
+
+template <class T>
+void PointCache<T>::setCapacity(size_t capacity) {
+    this->capacity = capacity;
+    while (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+template <class T>
+inline void PointCache<T>::clear() {
+    index.clear();
+    entries.clear();
+}
+
+static PointCache<G1> g1Cache;
+static PointCache<G2> g2Cache;
+
+void setPointCacheSize(size_t capacity) {
+    g1Cache.setCapacity(capacity);
+    g2Cache.setCapacity(capacity);
+}
+
+ShortScalar ShortScalar::getRand() {
+    ShortScalar result;
+    getRandMany(&result, 1);
+    return result;
+}
+
+void ShortScalar::getRandMany(ShortScalar *els, size_t n) {
+    unsigned char buf[8];
+    for (size_t i = 0; i < n; ++i) {
+        randomBytes(buf, 8);
+        uint64_t x = 0;
+        for (int j = 0; j < 8; ++j)
+            x = (x << 8) | buf[j];
+        els[i] = ShortScalar(x);
+    }
+}
+
+/* Number of windows of SHORT_WINDOW bits needed for all the scalars */
+int shortWindows(const std::vector<uint64_t> &m) {
+    uint64_t all = 0;
+    for (uint64_t x : m)
+        all |= x;
+    int windows = 0;
+    while ((windows * SHORT_WINDOW < 64) && (all >> (windows * SHORT_WINDOW)))
+        ++windows;
+    return windows;
+}
+
+/* Sets *acc to the sum of the m[i] *els[i], with the scalars read by
+ * windows of SHORT_WINDOW bits and one shared doubling chain (Straus'
+ * method); returns false instead if all the scalars are null.
+ * The group of the backend elements T is written additively, with
+ * set(r, a) for r = a, add(r, a) for r += a and dbl(r) for r += r; tab
+ * holds els.size() << SHORT_WINDOW elements ready to be set, in which
+ * the small multiples of the els[i] are stored. */
+template <class T, class Set, class Add, class Dbl>
+bool shortCombination(T *acc, const std::vector<T*> &els,
+                      const std::vector<uint64_t> &m, T *tab,
+                      Set set, Add add, Dbl dbl) {
+    const int size = 1 << SHORT_WINDOW;
+    for (size_t i = 0; i < els.size(); ++i) {
+        T *t = tab + i * size;
+        set(&t[1], els[i]);
+        for (int j = 2; j < size; ++j) {
+            set(&t[j], &t[j - 1]);
+            add(&t[j], els[i]);
+        }
+    }
+    bool started = false;
+    for (int k = (shortWindows(m) - 1) * SHORT_WINDOW; k >= 0;
+         k -= SHORT_WINDOW) {
+        if (started) {
+            for (int j = 0; j < SHORT_WINDOW; ++j)
+                dbl(acc);
+        }
+        for (size_t i = 0; i < els.size(); ++i) {
+            int w = (int) ((m[i] >> k) & (size - 1));
+            if (!w) continue;
+            if (started) {
+                add(acc, &tab[i * size + w]);
+            } else {
+                set(acc, &tab[i * size + w]);
+                started = true;
+            }
+        }
+    }
+    return started;
+}
+
+G1 &G1::operator*=(const ShortScalar &other) {
+    return *this = mulSum(this, &other, 1);
+}
+
+G1 G1::operator*(const ShortScalar &other) const {
+    return mulSum(this, &other, 1);
+}
+
+G1 operator*(const ShortScalar &m, const G1 &g) {
+    return G1::mulSum(&g, &m, 1);
+}
+
+G2 &G2::operator*=(const ShortScalar &other) {
+    return *this = mulSum(this, &other, 1);
+}
+
+G2 G2::operator*(const ShortScalar &other) const {
+    return mulSum(this, &other, 1);
+}
+
+G2 operator*(const ShortScalar &m, const G2 &g) {
+    return G2::mulSum(&g, &m, 1);
+}
+
+GT &GT::operator^=(const ShortScalar &other) {
+    return *this = powProd(this, &other, 1);
+}
+
+GT GT::operator^(const ShortScalar &other) const {
+    return powProd(this, &other, 1);
+}
+
+} /* End of namespace pairings */
+
 #if defined(USE_MIRACL)
 /* -------------------- MIRACL build -------------------- */
 
@@ -61,6 +337,8 @@
 
 #define MIRACL_BYTES (MIRACL / 8)
 
+#define MAX_RANDOM_BYTES 128
+
 namespace pairings {
 
 static PFC *pfc;
@@ -107,6 +385,20 @@ int getNBits(const Big &n) {
 
 static ::GT *rndSeed = NULL;
 
+/* Fixed bases of the random group elements, with their precomputations */
+static ::G1 *rndBase1 = NULL;
+static ::G2 *rndBase2 = NULL;
+
+/* Constants of the Shallue-van de Woestijne map to G1, in the version of
+ * Fouque and Tibouchi for BN curves y^2 = x^3 + b */
+struct SWConstants {
+    ZZn b;      // Coefficient of the curve
+    ZZn s;      // Square root of -3
+    ZZn c;      // (-1 + s) / 2
+    ZZn third;  // 1 / 3
+};
+static SWConstants *sw = NULL;
+
 void initialize_pairings(int len, const char *data) {
     ASSERT(len >= 0, "Negative length");
     csprng *rnd = new csprng;
@@ -123,13 +415,33 @@ void initialize_pairings(int len, const char *data) {
 #ifdef GSNIZK_IOSTREAM_NOTHREADS
     iostream_nothreads_buffer = new char[big_size];
 #endif
+    ::Big x, y;
+    g1.g.get(x, y);
+    sw = new SWConstants;
+    sw->b = ZZn(y) * ZZn(y) - ZZn(x) * ZZn(x) * ZZn(x);
+    sw->s = sqrt(ZZn(0) - ZZn(3));
+    sw->c = (sw->s - ZZn(1)) / ZZn(2);
+    sw->third = ZZn(1) / ZZn(3);
+    rndBase1 = new ::G1(g1);
+    pfc->precomp_for_mult(*rndBase1);
+    rndBase2 = new ::G2(g2);
+    pfc->precomp_for_mult(*rndBase2);
     rndSeed = new ::GT(pfc->pairing(g2, g1));
+    pfc->precomp_for_power(*rndSeed);
 }
 
 void terminate_pairings() {
     if (!rndSeed) return;
+    g1Cache.clear();
+    g2Cache.clear();
     delete rndSeed;
     rndSeed = NULL;
+    delete sw;
+    sw = NULL;
+    delete rndBase1;
+    rndBase1 = NULL;
+    delete rndBase2;
+    rndBase2 = NULL;
     if (Fp::zero->c) {
         ASSERT(false, "Trailing references");
         --Fp::zero->c;
@@ -152,33 +464,11 @@ void terminate_pairings() {
 #endif
 }
 
-int getHashLen() {
-    return HASH_LEN_BYTES;
-}
-
-void getHash(const char *data, int len, char *hash) {
-#if HASH_LEN_BITS == 256
-    sha256 sh;
-    shs256_init(&sh);
-    for (int i = 0; i < len; i++)
-    {
-        shs256_process(&sh, (int) data[i]);
-    }
-    shs256_hash(&sh, hash);
-#elif HASH_LEN_BITS == 512
-    sha512 sh;
-    shs512_init(&sh);
-    for (int i = 0; i < len; i++)
-    {
-        shs512_process(&sh, (int) data[i]);
-    }
-    shs512_hash(&sh, hash);
-#else
-#error Error: Invalid value of HASH_LEN_BITS (pairings)
-#endif
+bool hasPrecomputations() {
+    return true;
 }
 
-bool hasPrecomputations() {
+bool hasGTCompression() {
     return true;
 }
 
@@ -210,12 +500,55 @@ void hashToZZn(const char *data, int len, const ::Big &n, ::Big &result) {
     hashToZZn(s, n, result);
 }
 
+/* Maps t to a point of the curve, inv being 1 / (t (1 + b + t^2)) or zero
+ * when the latter is not invertible; the map needs three quadratic
+ * characters and one square root whatever the value of t is */
+void swMap(const ZZn &t, const ZZn &inv, ::G1 *el) {
+    if (UNLIKELY(inv.iszero())) {
+        // Exceptional values of t (probability 3/p): try and increment
+        ::Big x0 = t;
+        while (!el->g.set(x0, x0)) ++x0;
+        return;
+    }
+    ZZn d = ZZn(1) + sw->b + t * t;
+    ZZn id = t * inv, it = d * inv;
+    ZZn w = sw->s * t * id;
+    ZZn x1 = sw->c - t * w;
+    ZZn x2 = ZZn(0) - ZZn(1) - x1;
+    ZZn x3 = ZZn(1) - d * d * it * it * sw->third;
+    ZZn y1 = x1 * x1 * x1 + sw->b;
+    ZZn y2 = x2 * x2 * x2 + sw->b;
+    ZZn y3 = x3 * x3 * x3 + sw->b;
+    bool q1 = qr(y1), q2 = qr(y2);
+    const ZZn &x = q1 ? x1 : (q2 ? x2 : x3);
+    ZZn y = sqrt(q1 ? y1 : (q2 ? y2 : y3));
+    if (!qr(t))
+        y = -y;
+    bool onCurve = el->g.set((::Big) x, (::Big) y);
+    ASSERT(onCurve, "Invalid point from the map to G1");
+    (void) onCurve;
+}
+
+void swMap(const char *hash, ::G1 *el) {
+    ::Big tb;
+    hashToZZn(hash, *pfc->mod, tb);
+    ZZn t(tb), den = t * (ZZn(1) + sw->b + t * t);
+    swMap(t, den.iszero() ? den : ZZn(1) / den, el);
+}
+
 Fp::Fp(int i) : d(new SharedData(reinterpret_cast<void*>(i >= 0 ?
         (new ::Big(i)) : (new ::Big(*pfc->ord - Big(-i)))))) {}
 
 Fp::Fp(unsigned long i)
     : d(new SharedData(reinterpret_cast<void*>(new ::Big(i)))) {}
 
+Fp ShortScalar::toFp() const {
+    // Note: unsigned long may only have 32 bits, hence the two halves
+    ::Big *_el = new ::Big((unsigned long) (v >> 32));
+    *_el = (*_el << 32) + ::Big((unsigned long) (v & 0xFFFFFFFFUL));
+    return Fp(reinterpret_cast<void*>(_el));
+}
+
 Fp Fp::operator-() const {
     const ::Big &_this = *reinterpret_cast< ::Big* >(d->p);
     if ((d == zero) || _this.iszero())
@@ -400,9 +733,27 @@ bool Fp::isUnit() const {
     return reinterpret_cast< ::Big* >(d->p)->isone();
 }
 
+/* Uniform random value in [0, n), by rejection sampling */
+void randomBelow(const ::Big &n, ::Big &result) {
+    int nbits = bits(n), len = (nbits + 7) >> 3;
+    unsigned char buf[MAX_RANDOM_BYTES];
+    ASSERT(len <= MAX_RANDOM_BYTES, "Modulus is too large");
+    do {
+        randomBytes(buf, len);
+        buf[0] &= (unsigned char) (0xFF >> ((len << 3) - nbits));
+        result = from_binary(len, reinterpret_cast<char*>(buf));
+    } while (result >= n);
+}
+
 Fp Fp::getRand() {
-    return Fp(reinterpret_cast<void*>(
-        new ::Big(strong_rand(pfc->RNG, *pfc->ord))));
+    ::Big *_el = new ::Big();
+    randomBelow(*pfc->ord, *_el);
+    return Fp(reinterpret_cast<void*>(_el));
+}
+
+void Fp::getRandMany(Fp *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
 }
 
 int Fp::getDataLen() {
@@ -415,6 +766,18 @@ Fp Fp::getValue(const char *data) {
         new ::Big(from_binary(big_size, const_cast<char*>(data)))));
 }
 
+void Fp::serializeMany(const Fp *els, size_t n, char *data) {
+    int len = getDataLen();
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i].getData(data);
+}
+
+void Fp::deserializeMany(const char *data, size_t n, Fp *els) {
+    int len = getDataLen();
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i] = getValue(data);
+}
+
 Fp Fp::fromHash(const char *data, int len) {
     ::Big *_el = new ::Big();
     hashToZZn(data, len, *pfc->ord, *_el);
@@ -674,17 +1037,77 @@ void G1::loadMultPrecomputations(char *data) {
     _this.mtbits = MR_ROUNDUP(bits(*pfc->ord),WINDOW_SIZE);
 }
 
+/* Normalizes all the points with a single inversion (Montgomery's trick),
+ * instead of one inversion per point when they are used */
+void normalizePoints(std::vector<epoint*> &points) {
+    if (points.size() < 2) return;
+    big *work = new big[points.size()];
+    for (size_t i = 0; i < points.size(); ++i)
+        work[i] = mirvar(0);
+    epoint_multi_norm(points.size(), work, points.data());
+    for (size_t i = 0; i < points.size(); ++i)
+        mirkill(work[i]);
+    delete[] work;
+}
+
+/* Group operations of shortCombination on the MIRACL points */
+template <class T> inline void pointSet(T *r, T *a) { *r = *a; }
+template <class T> inline void pointAdd(T *r, T *a) { *r += *a; }
+template <class T> inline void pointDbl(T *r) { *r += *r; }
+
+/* Group operations of shortCombination on the MIRACL values of GT */
+inline void gtMul(::ZZn12 *r, ::ZZn12 *a) { *r = *r * *a; }
+inline void gtSquare(::ZZn12 *r) { *r = *r * *r; }
+
 G1 G1::getRand() {
-    ::G1 *_el = new ::G1();
-    pfc->random(*_el);
+    ::Big b;
+    randomBelow(*pfc->ord, b);
     // Following is very unlikely, but we still want to handle it
-    if (UNLIKELY(_el->g.iszero())) {
+    if (UNLIKELY(b.iszero()))
+        return G1();
+    return G1(reinterpret_cast<void*>(new ::G1(pfc->mult(*rndBase1, b))));
+}
+
+void G1::mulMany(const G1 *els, size_t n, const Fp &m, G1 *out,
+                 int) {
+    // Note: PFC::mult already splits the scalar with the GLV method and
+    // MIRACL gives no way to share this recoding among several points
+    for (size_t i = 0; i < n; ++i)
+        out[i] = els[i] * m;
+}
+
+G1 G1::mulSum(const G1 *els, const ShortScalar *m, size_t n) {
+    std::vector< ::ECn*> _els;
+    std::vector<uint64_t> _m;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d && !m[i].isNull()) {
+            _els.push_back(&reinterpret_cast< ::G1* >(els[i].d->p)->g);
+            _m.push_back(m[i].getValue());
+        }
+    }
+    std::vector< ::ECn> tab(_els.size() << SHORT_WINDOW);
+    ::G1 *_el = new ::G1();
+    if ((!shortCombination(&_el->g, _els, _m, tab.data(), pointSet< ::ECn>,
+                           pointAdd< ::ECn>, pointDbl< ::ECn>)) ||
+            _el->g.iszero()) {
         delete _el;
         return G1();
     }
     return G1(reinterpret_cast<void*>(_el));
 }
 
+void G1::getRandMany(G1 *els, size_t n) {
+    std::vector<epoint*> points;
+    for (size_t i = 0; i < n; ++i) {
+        els[i] = getRand();
+        if (LIKELY(els[i].d)) {
+            points.push_back(
+                reinterpret_cast< ::G1* >(els[i].d->p)->g.get_point());
+        }
+    }
+    normalizePoints(points);
+}
+
 int G1::getDataLen(bool compressed) {
     if (compressed) {
         return big_size + 1;
@@ -700,8 +1123,14 @@ G1 G1::getValue(const char *data, bool compressed) {
         int lsb = (int) *(data++);
         if (lsb == NULL_ELEMENT_BYTE_VALUE)
             return G1();
+        G1 result;
+        if (g1Cache.find(data - 1, getDataLen(true), result))
+            return result;
         _el = new ::G1();
         _el->g.set(from_binary(big_size, const_cast<char*>(data)), lsb);
+        result = G1(reinterpret_cast<void*>(_el));
+        g1Cache.insert(data - 1, getDataLen(true), result);
+        return result;
     } else {
         _el = new ::G1();
         _el->g.set(from_binary(big_size, const_cast<char*>(data)),
@@ -714,37 +1143,144 @@ G1 G1::getValue(const char *data, bool compressed) {
     return G1(reinterpret_cast<void*>(_el));
 }
 
+void G1::serializeMany(const G1 *els, size_t n, char *data,
+                        bool compressed) {
+    normalizeMany(els, n);
+    int len = getDataLen(compressed);
+    /* Compressed null elements only set the first byte of their slot */
+    memset(data, 0, n * len);
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i].getData(data, compressed);
+}
+
+void G1::deserializeMany(const char *data, size_t n, G1 *els,
+                          bool compressed, int) {
+    int len = getDataLen(compressed);
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i] = getValue(data, compressed);
+}
+
+void G1::normalizeMany(const G1 *els, size_t n) {
+    std::vector<epoint*> points;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d) {
+            points.push_back(
+                reinterpret_cast< ::G1* >(els[i].d->p)->g.get_point());
+        }
+    }
+    normalizePoints(points);
+}
+
 G1 G1::fromHash(const char *data, int len) {
+    char s[HASH_LEN_BYTES];
+    getHash(data, len, s);
+    return fromHash(s);
+}
+
+G1 G1::fromHash(const char *hash) {
     ::G1 *_el = new ::G1();
-    ::Big x0;
-    hashToZZn(data, len, *pfc->mod, x0);
-    while (!_el->g.set(x0, x0)) ++x0;
-    // Following is very unlikely, but we still want to handle it
-    if (UNLIKELY(_el->g.iszero())) {
-        delete _el;
-        return G1();
-    }
+    swMap(hash, _el);
     return G1(reinterpret_cast<void*>(_el));
 }
 
-G1 G1::fromHash(const char *hash) {
+void G1::fromHashMany(const char **data, const int *len, int n, G1 *els) {
+    if (n <= 0) return;
+    char *hashes = new char[n * HASH_LEN_BYTES];
+    getHashMany(data, len, n, hashes);
+    // Montgomery's trick: one inversion for all the denominators
+    std::vector<ZZn> t(n), den(n), prod(n);
+    ZZn acc(1);
+    ::Big tb;
+    for (int i = 0; i < n; ++i) {
+        hashToZZn(hashes + i * HASH_LEN_BYTES, *pfc->mod, tb);
+        t[i] = ZZn(tb);
+        den[i] = t[i] * (ZZn(1) + sw->b + t[i] * t[i]);
+        prod[i] = acc;
+        if (LIKELY(!den[i].iszero()))
+            acc *= den[i];
+    }
+    acc = ZZn(1) / acc;
+    for (int i = n; i-- > 0;) {
+        if (UNLIKELY(den[i].iszero())) {
+            prod[i] = den[i];
+        } else {
+            prod[i] *= acc;
+            acc *= den[i];
+        }
+    }
+    delete[] hashes;
+    for (int i = 0; i < n; ++i) {
+        ::G1 *_el = new ::G1();
+        swMap(t[i], prod[i], _el);
+        els[i] = G1(reinterpret_cast<void*>(_el));
+    }
+}
+
+void G1::deref() {
+    if (d->c) {
+        --d->c;
+    } else {
+        delete reinterpret_cast< ::G1* >(d->p);
+        delete d;
+    }
+}
+
+/* The joint table keeps both base elements along with their own comb
+ * tables (see PFC::precomp_for_mult), which are then walked together */
+struct JointTableG1 {
+    G1 a, b;
+};
+
+G1JointTable::G1JointTable(const G1 &a, const G1 &b) {
+    JointTableG1 *_tab = new JointTableG1;
+    _tab->a = a;
+    _tab->b = b;
+    if (a.d && !reinterpret_cast< ::G1* >(a.d->p)->mtable)
+        _tab->a.precomputeForMult();
+    if (b.d && !reinterpret_cast< ::G1* >(b.d->p)->mtable)
+        _tab->b.precomputeForMult();
+    d = new SharedData(reinterpret_cast<void*>(_tab));
+}
+
+G1 G1JointTable::mult(const Fp &x, const Fp &y) const {
+    const JointTableG1 &_tab = *reinterpret_cast<JointTableG1*>(d->p);
+    if ((!_tab.a.d) || (!_tab.b.d))
+        return x * _tab.a + y * _tab.b;
+    const ::G1 &_a = *reinterpret_cast< ::G1* >(_tab.a.d->p);
+    const ::G1 &_b = *reinterpret_cast< ::G1* >(_tab.b.d->p);
+    if ((!_a.mtable) || (!_b.mtable))
+        return x * _tab.a + y * _tab.b;
+    const ::Big &_x = *reinterpret_cast< ::Big* >(x.d->p);
+    const ::Big &_y = *reinterpret_cast< ::Big* >(y.d->p);
+    // Note: Both combs have the same number of columns (see
+    // G1::loadMultPrecomputations), so that they share their doublings
+    int t = _a.mtbits, j;
     ::G1 *_el = new ::G1();
-    ::Big x0;
-    hashToZZn(hash, *pfc->mod, x0);
-    while (!_el->g.set(x0, x0)) ++x0;
-    // Following is very unlikely, but we still want to handle it
-    if (UNLIKELY(_el->g.iszero())) {
+    for (int i = t - 1; i >= 0; --i) {
+        _el->g += _el->g;
+        if ((j = recode(_x, t, WINDOW_SIZE, i)) > 0)
+            _el->g += _a.mtable[j];
+        if ((j = recode(_y, t, WINDOW_SIZE, i)) > 0)
+            _el->g += _b.mtable[j];
+    }
+    if (_el->g.iszero()) {
         delete _el;
         return G1();
     }
     return G1(reinterpret_cast<void*>(_el));
 }
 
-void G1::deref() {
+void G1JointTable::multMany(const Fp *x, const Fp *y, size_t n, G1 *out,
+                            int) const {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = mult(x[i], y[i]);
+}
+
+void G1JointTable::deref() {
     if (d->c) {
         --d->c;
     } else {
-        delete reinterpret_cast< ::G1* >(d->p);
+        delete reinterpret_cast<JointTableG1*>(d->p);
         delete d;
     }
 }
@@ -1060,10 +1596,40 @@ void G2::loadPairingPrecomputations(char *data) {
 }
 
 G2 G2::getRand() {
-    ::G2 *_el = new ::G2();
-    pfc->random(*_el);
+    ::Big b;
+    randomBelow(*pfc->ord, b);
     // Following is very unlikely, but we still want to handle it
-    if (UNLIKELY(_el->g.iszero())) {
+    if (UNLIKELY(b.iszero()))
+        return G2();
+    return G2(reinterpret_cast<void*>(new ::G2(pfc->mult(*rndBase2, b))));
+}
+
+void G2::getRandMany(G2 *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
+}
+
+void G2::mulMany(const G2 *els, size_t n, const Fp &m, G2 *out,
+                 int) {
+    // Note: PFC::mult already splits the scalar with the GLS method
+    for (size_t i = 0; i < n; ++i)
+        out[i] = els[i] * m;
+}
+
+G2 G2::mulSum(const G2 *els, const ShortScalar *m, size_t n) {
+    std::vector< ::ECn2*> _els;
+    std::vector<uint64_t> _m;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d && !m[i].isNull()) {
+            _els.push_back(&reinterpret_cast< ::G2* >(els[i].d->p)->g);
+            _m.push_back(m[i].getValue());
+        }
+    }
+    std::vector< ::ECn2> tab(_els.size() << SHORT_WINDOW);
+    ::G2 *_el = new ::G2();
+    if ((!shortCombination(&_el->g, _els, _m, tab.data(), pointSet< ::ECn2>,
+                           pointAdd< ::ECn2>, pointDbl< ::ECn2>)) ||
+            _el->g.iszero()) {
         delete _el;
         return G2();
     }
@@ -1085,6 +1651,9 @@ G2 G2::getValue(const char *data, bool compressed) {
         int lsb = (int) *(data++);
         if (lsb == NULL_ELEMENT_BYTE_VALUE)
             return G2();
+        G2 result;
+        if (g2Cache.find(data - 1, getDataLen(true), result))
+            return result;
         _el = new ::G2();
         ::Big b1, b2;
         b1 = from_binary(big_size, const_cast<char*>(data));
@@ -1096,6 +1665,9 @@ G2 G2::getValue(const char *data, bool compressed) {
         y.get(b1);
         if ((b1.get(1) & 1) != lsb)
             *_el = -(*_el);
+        result = G2(reinterpret_cast<void*>(_el));
+        g2Cache.insert(data - 1, getDataLen(true), result);
+        return result;
     } else {
         _el = new ::G2();
         ZZn2 x, y;
@@ -1115,6 +1687,22 @@ G2 G2::getValue(const char *data, bool compressed) {
     return G2(reinterpret_cast<void*>(_el));
 }
 
+void G2::serializeMany(const G2 *els, size_t n, char *data,
+                        bool compressed) {
+    int len = getDataLen(compressed);
+    /* Compressed null elements only set the first byte of their slot */
+    memset(data, 0, n * len);
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i].getData(data, compressed);
+}
+
+void G2::deserializeMany(const char *data, size_t n, G2 *els,
+                          bool compressed, int) {
+    int len = getDataLen(compressed);
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i] = getValue(data, compressed);
+}
+
 /* Fast multiplication of A by q (for Trace-Zero group members only)
  * Calculate q*P. P(X,Y) -> P(X^p,Y^p))
  * Function from the MIRACL library */
@@ -1199,6 +1787,65 @@ void G2::deref() {
     }
 }
 
+/* Same as JointTableG1 (see above) */
+struct JointTableG2 {
+    G2 a, b;
+};
+
+G2JointTable::G2JointTable(const G2 &a, const G2 &b) {
+    JointTableG2 *_tab = new JointTableG2;
+    _tab->a = a;
+    _tab->b = b;
+    if (a.d && !reinterpret_cast< ::G2* >(a.d->p)->mtable)
+        _tab->a.precomputeForMult();
+    if (b.d && !reinterpret_cast< ::G2* >(b.d->p)->mtable)
+        _tab->b.precomputeForMult();
+    d = new SharedData(reinterpret_cast<void*>(_tab));
+}
+
+G2 G2JointTable::mult(const Fp &x, const Fp &y) const {
+    const JointTableG2 &_tab = *reinterpret_cast<JointTableG2*>(d->p);
+    if ((!_tab.a.d) || (!_tab.b.d))
+        return x * _tab.a + y * _tab.b;
+    const ::G2 &_a = *reinterpret_cast< ::G2* >(_tab.a.d->p);
+    const ::G2 &_b = *reinterpret_cast< ::G2* >(_tab.b.d->p);
+    if ((!_a.mtable) || (!_b.mtable))
+        return x * _tab.a + y * _tab.b;
+    const ::Big &_x = *reinterpret_cast< ::Big* >(x.d->p);
+    const ::Big &_y = *reinterpret_cast< ::Big* >(y.d->p);
+    // Note: Both combs have the same number of columns (see
+    // G2::loadMultPrecomputations), so that they share their doublings
+    int t = _a.mtbits, j;
+    ::G2 *_el = new ::G2();
+    for (int i = t - 1; i >= 0; --i) {
+        _el->g += _el->g;
+        if ((j = recode(_x, t, WINDOW_SIZE, i)) > 0)
+            _el->g += _a.mtable[j];
+        if ((j = recode(_y, t, WINDOW_SIZE, i)) > 0)
+            _el->g += _b.mtable[j];
+    }
+    if (_el->g.iszero()) {
+        delete _el;
+        return G2();
+    }
+    return G2(reinterpret_cast<void*>(_el));
+}
+
+void G2JointTable::multMany(const Fp *x, const Fp *y, size_t n, G2 *out,
+                            int) const {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = mult(x[i], y[i]);
+}
+
+void G2JointTable::deref() {
+    if (d->c) {
+        --d->c;
+    } else {
+        delete reinterpret_cast<JointTableG2*>(d->p);
+        delete d;
+    }
+}
+
 GT GT::operator*(const GT &other) const {
     if (!d) return other;
     if (!other.d) return *this;
@@ -1327,7 +1974,73 @@ bool GT::operator==(const GT &other) const {
     return (_this == _other);
 }
 
-void GT::getData(char *data) const {
+/* Compression of the elements of GT, which are the unitary elements of
+ * Fp12 = Fp6[z], with z = (0, 1) in the first ZZn4 coordinate (conj is
+ * the Frobenius map of Fp12 over Fp6, fixing Fp6 and sending z to -z).
+ * The torus parametrization g = (c + z) / (c - z) maps each element g
+ * other than 1 to a single c = z (g + 1) / (g - 1) in Fp6, that is an
+ * element of the form ((c0, 0), (0, c2), (c1, 0)). Since -1 (for c = 0)
+ * is not in GT, c = 0 encodes 1 instead. */
+inline ::ZZn12 torus_z() {
+    ::ZZn2 x, y;
+    ::ZZn4 a, b;
+    y.set(::Big(1), ::Big(0));
+    a.set(x, y);
+    ::ZZn12 z;
+    z.set(a, b, b);
+    return z;
+}
+
+inline ::ZZn12 torus_one() {
+    ::ZZn2 x, y;
+    ::ZZn4 a, b;
+    x.set(::Big(1), ::Big(0));
+    a.set(x, y);
+    ::ZZn12 one;
+    one.set(a, b, b);
+    return one;
+}
+
+void compress_gt(const ::ZZn12 &g, ::ZZn2 c[3]) {
+    ::ZZn12 one = torus_one();
+    ::ZZn12 t = torus_z() * (g + one) * inverse(g - one);
+    ::ZZn4 a, b, e;
+    ::ZZn2 y;
+    t.get(a, b, e);
+    a.get(c[0], y);
+    b.get(y, c[2]);
+    e.get(c[1], y);
+}
+
+/* Returns false for the element 1 */
+bool decompress_gt(const ::ZZn2 c[3], ::ZZn12 &g) {
+    if (c[0].iszero() && c[1].iszero() && c[2].iszero())
+        return false;
+    ::ZZn2 zero;
+    ::ZZn4 a, b, e;
+    a.set(c[0], zero);
+    b.set(zero, c[2]);
+    e.set(c[1], zero);
+    ::ZZn12 t, z = torus_z();
+    t.set(a, b, e);
+    g = (t + z) * inverse(t - z);
+    return true;
+}
+
+void GT::getData(char *data, bool compressed) const {
+    if (compressed) {
+        ::ZZn2 c[3];
+        ::Big b1, b2;
+        if (d)
+            compress_gt(reinterpret_cast< ::GT* >(d->p)->g, c);
+        for (int i = 0; i < 3; ++i) {
+            c[i].get(b1, b2);
+            to_binary(b1, big_size, data, TRUE);
+            to_binary(b2, big_size, data += big_size, TRUE);
+            data += big_size;
+        }
+        return;
+    }
     if (!d) {
         ::Big b1 = ::Big(1);
         to_binary(b1, big_size, data, TRUE);
@@ -1499,23 +2212,67 @@ void GT::loadPowerPrecomputations(char *data) {
 
 GT GT::getRand() {
     ::Big b;
-    pfc->random(b);
-    ::GT *_el = new ::GT(pfc->power(*rndSeed, b));
+    randomBelow(*pfc->ord, b);
     // Following is very unlikely, but we still want to handle it
-    if (UNLIKELY(_el->g.iszero())) {
+    if (UNLIKELY(b.iszero()))
+        return GT();
+    return GT(reinterpret_cast<void*>(new ::GT(pfc->power(*rndSeed, b))));
+}
+
+void GT::getRandMany(GT *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
+}
+
+void GT::powMany(const GT *els, size_t n, const Fp &m, GT *out,
+                 int) {
+    // Note: PFC::power already splits the exponent with the GLS method
+    for (size_t i = 0; i < n; ++i)
+        out[i] = els[i] ^ m;
+}
+
+GT GT::powProd(const GT *els, const ShortScalar *m, size_t n) {
+    std::vector< ::ZZn12*> _els;
+    std::vector<uint64_t> _m;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d && !m[i].isNull()) {
+            _els.push_back(&reinterpret_cast< ::GT* >(els[i].d->p)->g);
+            _m.push_back(m[i].getValue());
+        }
+    }
+    std::vector< ::ZZn12> tab(_els.size() << SHORT_WINDOW);
+    ::GT *_el = new ::GT();
+    if ((!shortCombination(&_el->g, _els, _m, tab.data(), pointSet< ::ZZn12>,
+                           gtMul, gtSquare)) ||
+            _el->g.isunity()) {
         delete _el;
         return GT();
     }
     return GT(reinterpret_cast<void*>(_el));
 }
 
-int GT::getDataLen() {
-    return big_size * 12;
+int GT::getDataLen(bool compressed) {
+    return big_size * (compressed ? 6 : 12);
 }
 
-GT GT::getValue(const char *data) {
+GT GT::getValue(const char *data, bool compressed) {
     ::GT *_el = new ::GT();
     // Note: const keyword simply missing in from_binary
+    if (compressed) {
+        ::ZZn2 c[3];
+        for (int i = 0; i < 3; ++i) {
+            ::Big b1 = from_binary(big_size, const_cast<char*>(data));
+            ::Big b2 = from_binary(big_size,
+                                   const_cast<char*>(data + big_size));
+            c[i].set(b1, b2);
+            data += big_size << 1;
+        }
+        if ((!decompress_gt(c, _el->g)) || _el->g.isunity()) {
+            delete _el;
+            return GT();
+        }
+        return GT(reinterpret_cast<void*>(_el));
+    }
     ::ZZn4 a, b, c;
     ::ZZn2 x, y;
     ::Big b1, b2;
@@ -1604,18 +2361,17 @@ void GT::deref() {
 #include <pbc/pbc.h>
 #endif
 
-#if HASH_LEN_BITS == 256
-#include "sha256.h"
-#elif HASH_LEN_BITS == 512
-#include "sha512.h"
-#else
-#error Error: Invalid value of HASH_LEN_BITS (pairings)
-#endif
+#include <cstring>
+#include <functional>
+#include <thread>
 
 namespace pairings {
 
 static pairing_t p_params;
 
+/* Precomputations for the fixed bases of the random group elements */
+static element_pp_t rnd_base_g1, rnd_base_g2, rnd_base_gt;
+
 SharedData *Fp::zero = NULL, *Fp::one = NULL;
 
 #ifdef GSNIZK_IOSTREAM_NOTHREADS
@@ -1630,8 +2386,539 @@ void freeElement(void *ptr) {
     delete reinterpret_cast<element_ptr>(ptr);
 }
 
+/* Checks that p satisfies the equation y^2 = x^3 + a x + b of its curve,
+ * since element_from_bytes takes the coordinates as they are */
+bool on_curve(element_ptr p) {
+    element_ptr x = curve_x_coord(p), y = curve_y_coord(p);
+    element_t l, r;
+    element_init_same_as(l, x);
+    element_init_same_as(r, x);
+    element_square(l, y);
+    element_square(r, x);
+    element_add(r, r, curve_a_coeff(p));
+    element_mul(r, r, x);
+    element_add(r, r, curve_b_coeff(p));
+    bool result = !element_cmp(l, r);
+    element_clear(l);
+    element_clear(r);
+    return result;
+}
+
+/* Random function of PBC (used by element_random): uniform random value
+ * in [0, limit), by rejection sampling */
+void pbc_random(mpz_t result, mpz_t limit, void *) {
+    size_t nbits = mpz_sizeinbase(limit, 2), len = (nbits + 7) >> 3;
+    unsigned char small[128];
+    unsigned char *buf = (len <= sizeof(small)) ? small
+                                                : new unsigned char[len];
+    do {
+        randomBytes(buf, len);
+        buf[0] &= (unsigned char) (0xFF >> ((len << 3) - nbits));
+        mpz_import(result, len, 1, 1, 0, 0, buf);
+    } while (mpz_cmp(result, limit) >= 0);
+    if (buf != small)
+        delete[] buf;
+}
+
+/* Data of the GLV multiplication in G1 (see init_glv) */
+struct GLVData {
+    element_t beta;         // Cube root of unity of the base field
+    mpz_t a1, b1, a2, b2;   // Short vectors (a, b) with a + b lambda = 0 mod r
+};
+static GLVData *glv = NULL;
+
+/* On curves y^2 = x^3 + b, the endomorphism phi(x, y) = (beta x, y) acts
+ * on G1 as the multiplication by a root lambda of X^2 + X + 1 mod r, so
+ * that k P = k1 P + k2 phi(P) with k1 and k2 about half as long as r;
+ * the short vectors come from the extended Euclidean algorithm on
+ * (r, lambda), as described by Gallant, Lambert and Vanstone.
+ * The method is left disabled for the curves where phi does not match. */
+void init_glv(element_ptr g) {
+    if (element_is0(g)) return;
+    element_ptr x = curve_x_coord(g);
+    mpz_t e;
+    mpz_init(e);
+    mpz_sub_ui(e, x->field->order, 1);
+    if (mpz_fdiv_ui(e, 3)) {
+        mpz_clear(e);
+        return;
+    }
+    mpz_divexact_ui(e, e, 3);
+    element_t beta, lambda, one;
+    element_init_same_as(beta, x);
+    do {
+        element_random(beta);
+        element_pow_mpz(beta, beta, e);
+    } while (element_is0(beta) || element_is1(beta));
+    mpz_clear(e);
+    element_init_Zr(lambda, p_params);
+    element_init_Zr(one, p_params);
+    element_set1(one);
+    element_set_si(lambda, -3);
+    bool found = element_is_sqr(lambda);
+    if (found) {
+        element_t p1, p2;
+        element_init_same_as(p1, g);
+        element_init_same_as(p2, g);
+        element_set(p1, g);
+        element_mul(curve_x_coord(p1), curve_x_coord(p1), beta);
+        element_sqrt(lambda, lambda);
+        element_sub(lambda, lambda, one);
+        element_halve(lambda, lambda);
+        element_mul_zn(p2, g, lambda);
+        if (element_cmp(p1, p2)) {
+            // The other root of X^2 + X + 1
+            element_neg(lambda, lambda);
+            element_sub(lambda, lambda, one);
+            element_mul_zn(p2, g, lambda);
+            found = !element_cmp(p1, p2);
+        }
+        element_clear(p1);
+        element_clear(p2);
+    }
+    if (found) {
+        glv = new GLVData;
+        element_init_same_as(glv->beta, beta);
+        element_set(glv->beta, beta);
+        mpz_t r0, r1, r2, t0, t1, t2, q, sq;
+        mpz_inits(r0, r1, r2, t0, t1, t2, q, sq, NULL);
+        mpz_inits(glv->a1, glv->b1, glv->a2, glv->b2, NULL);
+        element_to_mpz(r1, lambda);
+        mpz_set(r0, p_params->r);
+        mpz_set_ui(t0, 0);
+        mpz_set_ui(t1, 1);
+        mpz_sqrt(sq, p_params->r);
+        // Invariant: r_i = t_i lambda mod r
+        while (mpz_cmp(r1, sq) >= 0) {
+            mpz_fdiv_q(q, r0, r1);
+            mpz_submul(r0, q, r1);
+            mpz_swap(r0, r1);
+            mpz_submul(t0, q, t1);
+            mpz_swap(t0, t1);
+        }
+        mpz_set(glv->a1, r1);
+        mpz_neg(glv->b1, t1);
+        mpz_fdiv_q(q, r0, r1);
+        mpz_set(r2, r0);
+        mpz_submul(r2, q, r1);
+        mpz_set(t2, t0);
+        mpz_submul(t2, q, t1);
+        // Shortest of (r0, -t0) and (r2, -t2)
+        mpz_mul(q, r0, r0);
+        mpz_addmul(q, t0, t0);
+        mpz_mul(sq, r2, r2);
+        mpz_addmul(sq, t2, t2);
+        if (mpz_cmp(q, sq) <= 0) {
+            mpz_set(glv->a2, r0);
+            mpz_neg(glv->b2, t0);
+        } else {
+            mpz_set(glv->a2, r2);
+            mpz_neg(glv->b2, t2);
+        }
+        mpz_clears(r0, r1, r2, t0, t1, t2, q, sq, NULL);
+    }
+    element_clear(beta);
+    element_clear(lambda);
+    element_clear(one);
+}
+
+void clear_glv() {
+    if (!glv) return;
+    element_clear(glv->beta);
+    mpz_clears(glv->a1, glv->b1, glv->a2, glv->b2, NULL);
+    delete glv;
+    glv = NULL;
+}
+
+/* Constants of the Shallue-van de Woestijne map to G1 (see init_sw) */
+struct SWData {
+    element_t b;        // Coefficient of the curve
+    element_t s;        // Square root of -3
+    element_t c;        // (-1 + s) / 2
+    element_t third;    // 1 / 3
+    element_t base;     // Some non-null point of G1
+};
+static SWData *sw = NULL;
+
+/* Sets y to x^3 + b */
+inline void sw_rhs(element_ptr y, element_ptr x) {
+    element_square(y, x);
+    element_mul(y, y, x);
+    element_add(y, y, sw->b);
+}
+
+/* Maps the hash to G1 with the same encoding as swMap with MIRACL, or
+ * with PBC's own try-and-increment when the encoding does not apply */
+void sw_map(element_ptr el, const char *hash) {
+    if (!sw) {
+        // Note: const keyword simply missing in element_from_hash
+        element_from_hash(el, const_cast<char*>(hash), HASH_LEN_BYTES);
+        return;
+    }
+    element_t t, d, inv, one, x[3], y[3];
+    element_init_same_as(t, sw->b);
+    element_init_same_as(d, sw->b);
+    element_init_same_as(inv, sw->b);
+    element_init_same_as(one, sw->b);
+    for (int k = 0; k < 3; ++k) {
+        element_init_same_as(x[k], sw->b);
+        element_init_same_as(y[k], sw->b);
+    }
+    element_set1(one);
+    element_from_hash(t, const_cast<char*>(hash), HASH_LEN_BYTES);
+    // d = 1 + b + t^2, inv = 1 / (t d)
+    element_square(d, t);
+    element_add(d, d, sw->b);
+    element_add(d, d, one);
+    element_mul(inv, t, d);
+    bool exceptional = element_is0(inv);
+    if (LIKELY(!exceptional)) {
+        element_invert(inv, inv);
+        // x1 = c - s t^2 / d
+        element_mul(x[0], inv, t);
+        element_mul(x[0], x[0], t);
+        element_mul(x[0], x[0], t);
+        element_mul(x[0], x[0], sw->s);
+        element_sub(x[0], sw->c, x[0]);
+        // x2 = -1 - x1
+        element_neg(x[1], x[0]);
+        element_sub(x[1], x[1], one);
+        // x3 = 1 - (d / t)^2 / 3
+        element_mul(x[2], inv, d);
+        element_mul(x[2], x[2], d);
+        element_square(x[2], x[2]);
+        element_mul(x[2], x[2], sw->third);
+        element_sub(x[2], one, x[2]);
+        // Note: The three characters are computed whatever the value of t
+        bool q[3];
+        for (int k = 0; k < 3; ++k) {
+            sw_rhs(y[k], x[k]);
+            q[k] = element_is_sqr(y[k]);
+        }
+        int k = q[0] ? 0 : (q[1] ? 1 : 2);
+        element_sqrt(y[k], y[k]);
+        // The root given by element_sqrt depends on a random non-residue
+        bool positive = element_is_sqr(t);
+        if ((element_sign(y[k]) > 0) != positive)
+            element_neg(y[k], y[k]);
+        // Note: PBC has no setter for the coordinates of a point, so we
+        // overwrite the ones of a copy of a non-null point instead
+        element_set(el, sw->base);
+        element_set(curve_x_coord(el), x[k]);
+        element_set(curve_y_coord(el), y[k]);
+        ASSERT(on_curve(el), "Invalid point from the map to G1");
+    }
+    element_clear(t);
+    element_clear(d);
+    element_clear(inv);
+    element_clear(one);
+    for (int k = 0; k < 3; ++k) {
+        element_clear(x[k]);
+        element_clear(y[k]);
+    }
+    if (UNLIKELY(exceptional)) {
+        // Exceptional values of t (probability 3/p)
+        element_from_hash(el, const_cast<char*>(hash), HASH_LEN_BYTES);
+    }
+}
+
+void clear_sw() {
+    if (!sw) return;
+    element_clear(sw->b);
+    element_clear(sw->s);
+    element_clear(sw->c);
+    element_clear(sw->third);
+    element_clear(sw->base);
+    delete sw;
+    sw = NULL;
+}
+
+/* The Shallue-van de Woestijne encoding of Fouque and Tibouchi, as used
+ * with MIRACL, needs a curve y^2 = x^3 + b with a square root of -3 in
+ * the base field: this is the case exactly when GLV applies (see
+ * init_glv). The points it gives must also be in G1, so it is left
+ * disabled for the curves with a cofactor. */
+void init_sw(element_ptr g) {
+    if (!glv) return;
+    sw = new SWData;
+    element_init_same_as(sw->b, curve_x_coord(g));
+    element_init_same_as(sw->s, sw->b);
+    element_init_same_as(sw->c, sw->b);
+    element_init_same_as(sw->third, sw->b);
+    element_init_same_as(sw->base, g);
+    element_set(sw->b, curve_b_coeff(g));
+    element_set_si(sw->s, -3);
+    element_sqrt(sw->s, sw->s);
+    element_set1(sw->c);
+    element_sub(sw->c, sw->s, sw->c);
+    element_halve(sw->c, sw->c);
+    element_set_si(sw->third, 3);
+    element_invert(sw->third, sw->third);
+    element_set(sw->base, g);
+    element_t p;
+    element_init_same_as(p, g);
+    char hash[HASH_LEN_BYTES];
+    getHash("G1", 2, hash);
+    sw_map(p, hash);
+    element_mul_mpz(p, p, p_params->r);
+    bool cofactor = !element_is0(p);
+    element_clear(p);
+    if (cofactor)
+        clear_sw();
+}
+
+/* q = round(x / n), for n > 0 */
+void round_div(mpz_t q, const mpz_t x, const mpz_t n) {
+    mpz_t d;
+    mpz_init(d);
+    mpz_mul_2exp(q, x, 1);
+    mpz_add(q, q, n);
+    mpz_mul_2exp(d, n, 1);
+    mpz_fdiv_q(q, q, d);
+    mpz_clear(d);
+}
+
+/* Splits k into k1 + k2 lambda mod r (see init_glv) */
+void glv_split(element_ptr k, mpz_t k1, mpz_t k2) {
+    mpz_t c1, c2;
+    mpz_inits(c1, c2, NULL);
+    element_to_mpz(k1, k);
+    mpz_mul(c1, glv->b2, k1);
+    round_div(c1, c1, p_params->r);
+    mpz_mul(c2, glv->b1, k1);
+    mpz_neg(c2, c2);
+    round_div(c2, c2, p_params->r);
+    // k1 = k - c1 a1 - c2 a2, k2 = - c1 b1 - c2 b2
+    mpz_submul(k1, c1, glv->a1);
+    mpz_submul(k1, c2, glv->a2);
+    mpz_mul(k2, c1, glv->b1);
+    mpz_addmul(k2, c2, glv->b2);
+    mpz_neg(k2, k2);
+    mpz_clears(c1, c2, NULL);
+}
+
+/* out = k1 p + k2 phi(p), for a split scalar (see glv_split) */
+void glv_mul(element_ptr out, element_ptr p, const mpz_t k1, const mpz_t k2) {
+    mpz_t n1, n2;
+    mpz_init_set(n1, k1);
+    mpz_init_set(n2, k2);
+    element_t p1, p2;
+    element_init_same_as(p1, p);
+    element_init_same_as(p2, p);
+    element_set(p1, p);
+    element_set(p2, p);
+    element_mul(curve_x_coord(p2), curve_x_coord(p2), glv->beta);
+    if (mpz_sgn(n1) < 0) {
+        mpz_neg(n1, n1);
+        element_neg(p1, p1);
+    }
+    if (mpz_sgn(n2) < 0) {
+        mpz_neg(n2, n2);
+        element_neg(p2, p2);
+    }
+    element_pow2_mpz(out, p1, n1, p2, n2);
+    element_clear(p1);
+    element_clear(p2);
+    mpz_clears(n1, n2, NULL);
+}
+
+/* out = k p in G1, with the GLV method when available */
+void mul_g1(element_ptr out, element_ptr p, element_ptr k) {
+    if (!glv) {
+        element_mul_zn(out, p, k);
+        return;
+    }
+    mpz_t k1, k2;
+    mpz_inits(k1, k2, NULL);
+    glv_split(k, k1, k2);
+    glv_mul(out, p, k1, k2);
+    mpz_clears(k1, k2, NULL);
+}
+
+/* Number of comb teeth per base element in the joint tables */
+#define JOINT_TEETH 4
+
+/* Joint comb table of two elements a and b (see G1JointTable): entry i
+ * is the sum of the 2^(k spacing) a for the bits k < JOINT_TEETH set in i
+ * and of the 2^((k - JOINT_TEETH) spacing) b for the other bits set in i */
+struct JointTable {
+    int spacing;
+    element_t tab[1 << (2 * JOINT_TEETH)];
+};
+
+JointTable *joint_init(element_ptr a, element_ptr b) {
+    JointTable *t = new JointTable;
+    t->spacing = (mpz_sizeinbase(p_params->r, 2) + JOINT_TEETH - 1)
+            / JOINT_TEETH;
+    for (int i = 0; i < (1 << (2 * JOINT_TEETH)); ++i)
+        element_init_same_as(t->tab[i], a);
+    element_set0(t->tab[0]);
+    element_t base;
+    element_init_same_as(base, a);
+    for (int k = 0; k < 2 * JOINT_TEETH; ++k) {
+        if (k == 0) {
+            element_set(base, a);
+        } else if (k == JOINT_TEETH) {
+            element_set(base, b);
+        } else {
+            for (int j = 0; j < t->spacing; ++j)
+                element_double(base, base);
+        }
+        const int bit = 1 << k;
+        for (int i = 0; i < bit; ++i)
+            element_add(t->tab[bit | i], t->tab[i], base);
+    }
+    element_clear(base);
+    return t;
+}
+
+void joint_clear(JointTable *t) {
+    for (int i = 0; i < (1 << (2 * JOINT_TEETH)); ++i)
+        element_clear(t->tab[i]);
+    delete t;
+}
+
+/* out = x a + y b, with one doubling per column of the comb */
+void joint_mult(element_ptr out, const JointTable *t,
+                element_ptr x, element_ptr y) {
+    mpz_t _x, _y;
+    mpz_inits(_x, _y, NULL);
+    element_to_mpz(_x, x);
+    element_to_mpz(_y, y);
+    element_set0(out);
+    for (int i = t->spacing - 1; i >= 0; --i) {
+        element_double(out, out);
+        int idx = 0;
+        for (int k = 0; k < JOINT_TEETH; ++k) {
+            idx |= mpz_tstbit(_x, k * t->spacing + i) << k;
+            idx |= mpz_tstbit(_y, k * t->spacing + i) << (k + JOINT_TEETH);
+        }
+        // Note: const keyword simply missing in element_add
+        if (idx)
+            element_add(out, out, const_cast<element_ptr>(t->tab[idx]));
+    }
+    mpz_clears(_x, _y, NULL);
+}
+
+/* Calls work on consecutive ranges of [0, n), with up to threads threads */
+void parallelFor(size_t n, int threads,
+                 const std::function<void(size_t,size_t)> &work) {
+    if ((threads <= 1) || (n < 2)) {
+        work(0, n);
+        return;
+    }
+    if ((size_t) threads > n)
+        threads = (int) n;
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    size_t begin = 0;
+    for (int k = 0; k < threads; ++k) {
+        size_t end = begin + (n - begin) / (threads - k);
+        if (k == threads - 1)
+            work(begin, end);
+        else
+            pool.push_back(std::thread(work, begin, end));
+        begin = end;
+    }
+    for (std::thread &th : pool)
+        th.join();
+}
+
+/* Replaces each non-null raw element p of els with a new element r set
+ * by op(r, p), with up to threads threads (see parallelFor) */
+void mapElements(std::vector<element_ptr> &els, int threads,
+                 const std::function<void(element_ptr,element_ptr)> &op) {
+    parallelFor(els.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!els[i]) continue;
+            element_ptr r = new element_s;
+            element_init_same_as(r, els[i]);
+            op(r, els[i]);
+            els[i] = r;
+        }
+    });
+}
+
+/* Decodes the data of a point of the group of proto, giving NULL for the
+ * null or invalid points */
+element_ptr decode_point(const char *data, bool compressed,
+                         element_ptr proto) {
+    // Note: const keyword simply missing in element_from_bytes_[...]
+    element_ptr _el;
+    if (compressed) {
+        int lsb = (int) *(data++);
+        if (lsb == NULL_ELEMENT_BYTE_VALUE)
+            return NULL;
+        _el = new element_s;
+        element_init_same_as(_el, proto);
+        element_from_bytes_x_only(_el, reinterpret_cast<unsigned char*>(
+                                      const_cast<char*>(data)));
+        if (lsb != ((element_sign(element_y(_el)) > 0) ? 1 : 0))
+            element_neg(_el, _el);
+    } else {
+        _el = new element_s;
+        element_init_same_as(_el, proto);
+        element_from_bytes(_el, reinterpret_cast<unsigned char*>(
+                                      const_cast<char*>(data)));
+        // Note: Like ECn::set with MIRACL, invalid points give null elements
+        if (element_is0(_el) || !on_curve(_el)) {
+            freeElement(_el);
+            return NULL;
+        }
+    }
+    return _el;
+}
+
+/* Decodes the points of data (len bytes each) of the group of proto for
+ * which todo[i] is set into res[i], with up to threads threads (see
+ * parallelFor) */
+void decode_points(const char *data, int len, bool compressed,
+                   element_ptr proto, const std::vector<bool> &todo,
+                   std::vector<element_ptr> &res, int threads) {
+    // Note: PBC picks the non-residue used by its square roots the first
+    // time it needs it, so this must not happen in the workers
+    if (compressed)
+        field_get_nqr(curve_x_coord(proto)->field);
+    parallelFor(todo.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (todo[i])
+                res[i] = decode_point(data + i * len, compressed, proto);
+        }
+    });
+}
+
+/* Sets out to the sum of the m[i] els[i] (or to the product of the
+ * els[i]^m[i] in GT, if gt is set) with shortCombination; returns false
+ * instead if all the scalars are null */
+bool short_combination(element_ptr out, const std::vector<element_ptr> &els,
+                       const std::vector<uint64_t> &m, bool gt) {
+    typedef void (*Add)(element_ptr, element_ptr);
+    typedef void (*Dbl)(element_ptr);
+    Add add = [](element_ptr r, element_ptr a) { element_add(r, r, a); };
+    Dbl dbl = [](element_ptr r) { element_double(r, r); };
+    if (gt) {
+        add = [](element_ptr r, element_ptr a) { element_mul(r, r, a); };
+        dbl = [](element_ptr r) { element_square(r, r); };
+    }
+    const int size = 1 << SHORT_WINDOW;
+    std::vector<element_s> tab(els.size() * size);
+    // Note: The multiples start at index 1 in each part of the table
+    for (size_t i = 0; i < els.size(); ++i) {
+        for (int j = 1; j < size; ++j)
+            element_init_same_as(&tab[i * size + j], els[i]);
+    }
+    bool started = shortCombination(out, els, m, tab.data(),
+        [](element_ptr r, element_ptr a) { element_set(r, a); }, add, dbl);
+    for (size_t i = 0; i < els.size(); ++i) {
+        for (int j = 1; j < size; ++j)
+            element_clear(&tab[i * size + j]);
+    }
+    return started;
+}
+
 void initialize_pairings(int len, const char *data) {
     ASSERT(len >= 0, "Negative length");
+    pbc_random_set_function(pbc_random, NULL);
     pairing_init_set_buf(p_params, data, len);
     ASSERT(!pairing_is_symmetric(p_params), "pairing is symmetric");
     element_ptr _el = new element_s;
@@ -1652,10 +2939,30 @@ void initialize_pairings(int len, const char *data) {
     if (UNLIKELY(cmp > buffer_size)) buffer_size = cmp;
     iostream_nothreads_buffer = new char[buffer_size];
 #endif
+    element_t t;
+    element_init_GT(t, p_params);
+    element_t g1, g2;
+    element_init_G1(g1, p_params);
+    element_init_G2(g2, p_params);
+    do {
+        element_random(g1);
+        element_random(g2);
+        element_pairing(t, g1, g2);
+    } while (element_is1(t));
+    element_pp_init(rnd_base_g1, g1);
+    element_pp_init(rnd_base_g2, g2);
+    element_pp_init(rnd_base_gt, t);
+    init_glv(g1);
+    init_sw(g1);
+    element_clear(g1);
+    element_clear(g2);
+    element_clear(t);
 }
 
 void terminate_pairings() {
     if (!Fp::zero) return;
+    g1Cache.clear();
+    g2Cache.clear();
     if (Fp::zero->c) {
         ASSERT(false, "Trailing references");
         --Fp::zero->c;
@@ -1671,27 +2978,22 @@ void terminate_pairings() {
         freeElement(Fp::one->p);
         delete Fp::one;
     }
+    element_pp_clear(rnd_base_g1);
+    element_pp_clear(rnd_base_g2);
+    element_pp_clear(rnd_base_gt);
+    clear_sw();
+    clear_glv();
     pairing_clear(p_params);
 #ifdef GSNIZK_IOSTREAM_NOTHREADS
     delete[] iostream_nothreads_buffer;
 #endif
 }
 
-int getHashLen() {
-    return HASH_LEN_BYTES;
-}
-
-void getHash(const char *data, int len, char *hash) {
-#if HASH_LEN_BITS == 256
-    hash_sha256(data, len, hash);
-#elif HASH_LEN_BITS == 512
-    hash_sha512(data, len, hash);
-#else
-#error Error: Invalid value of HASH_LEN_BITS (pairings)
-#endif
+bool hasPrecomputations() {
+    return false;
 }
 
-bool hasPrecomputations() {
+bool hasGTCompression() {
     return false;
 }
 
@@ -1721,6 +3023,17 @@ Fp::Fp(unsigned long i) {
     d = new SharedData(reinterpret_cast<void*>(_el));
 }
 
+Fp ShortScalar::toFp() const {
+    element_ptr _el = new element_s;
+    element_init_Zr(_el, p_params);
+    mpz_t _v;
+    mpz_init(_v);
+    mpz_import(_v, 1, 1, sizeof(v), 0, 0, &v);
+    element_set_mpz(_el, _v);
+    mpz_clear(_v);
+    return Fp(reinterpret_cast<void*>(_el));
+}
+
 Fp Fp::operator-() const {
     const element_ptr &_this = reinterpret_cast<element_ptr>(d->p);
     if ((d == zero) || element_is0(_this))
@@ -1929,6 +3242,11 @@ Fp Fp::getRand() {
     return Fp(reinterpret_cast<void*>(_el));
 }
 
+void Fp::getRandMany(Fp *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
+}
+
 int Fp::getDataLen() {
     return pairing_length_in_bytes_Zr(p_params);
 }
@@ -1942,15 +3260,21 @@ Fp Fp::getValue(const char *data) {
     return Fp(reinterpret_cast<void*>(_el));
 }
 
+void Fp::serializeMany(const Fp *els, size_t n, char *data) {
+    int len = getDataLen();
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i].getData(data);
+}
+
+void Fp::deserializeMany(const char *data, size_t n, Fp *els) {
+    int len = getDataLen();
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i] = getValue(data);
+}
+
 void element_from_unhashed_data(const char *data, int len, element_ptr v) {
     char s[HASH_LEN_BYTES];
-#if HASH_LEN_BITS == 256
-    hash_sha256(data, len, s);
-#elif HASH_LEN_BITS == 512
-    hash_sha512(data, len, s);
-#else
-#error Error: Invalid value of HASH_LEN_BITS (pairings)
-#endif
+    getHash(data, len, s);
     element_from_hash(v, s, HASH_LEN_BYTES);
 }
 
@@ -2089,7 +3413,7 @@ G1 &G1::operator*=(const Fp &other) {
     // the result won't be null either.
     element_ptr _el = new element_s;
     element_init_G1(_el, p_params);
-    element_mul_zn(_el, _this, _other);
+    mul_g1(_el, _this, _other);
     if (d->c) {
         --d->c;
         d = new SharedData(_el);
@@ -2109,7 +3433,7 @@ G1 G1::operator*(const Fp &other) const {
     // the result won't be null either.
     element_ptr _el = new element_s;
     element_init_G1(_el, p_params);
-    element_mul_zn(_el, _this, _other);
+    mul_g1(_el, _this, _other);
     return G1(reinterpret_cast<void*>(_el));
 }
 
@@ -2122,7 +3446,7 @@ G1 operator*(const Fp &m, const G1 &g) {
     // the result won't be null either.
     element_ptr _el = new element_s;
     element_init_G1(_el, p_params);
-    element_mul_zn(_el, _g, _m);
+    mul_g1(_el, _g, _m);
     return G1(reinterpret_cast<void*>(_el));
 }
 
@@ -2236,9 +3560,13 @@ void G1::loadMultPrecomputations(char *data) {
 }
 
 G1 G1::getRand() {
+    element_t r;
+    element_init_Zr(r, p_params);
+    element_random(r);
     element_ptr _el = new element_s;
     element_init_G1(_el, p_params);
-    element_random(_el);
+    element_pp_pow_zn(_el, r, rnd_base_g1);
+    element_clear(r);
     // Following is very unlikely, but we still want to handle it
     if (UNLIKELY(element_is0(_el))) {
         freeElement(_el);
@@ -2247,6 +3575,61 @@ G1 G1::getRand() {
     return G1(reinterpret_cast<void*>(_el));
 }
 
+void G1::getRandMany(G1 *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
+}
+
+void G1::mulMany(const G1 *els, size_t n, const Fp &m, G1 *out,
+                 int threads) {
+    const element_ptr &_m = reinterpret_cast<element_ptr>(m.d->p);
+    if ((m.d == Fp::one) || (m.d == Fp::zero) ||
+            element_is1(_m) || element_is0(_m)) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = els[i] * m;
+        return;
+    }
+    std::vector<element_ptr> res(n);
+    for (size_t i = 0; i < n; ++i)
+        res[i] = els[i].d ? reinterpret_cast<element_ptr>(els[i].d->p) : NULL;
+    if (glv) {
+        // The scalar is split only once for all the elements
+        mpz_t k1, k2;
+        mpz_inits(k1, k2, NULL);
+        glv_split(_m, k1, k2);
+        mapElements(res, threads, [&](element_ptr r, element_ptr p) {
+            glv_mul(r, p, k1, k2);
+        });
+        mpz_clears(k1, k2, NULL);
+    } else {
+        mapElements(res, threads, [&](element_ptr r, element_ptr p) {
+            element_mul_zn(r, p, _m);
+        });
+    }
+    // Note: Since neither the elements nor the scalar are null,
+    // the results won't be null either.
+    for (size_t i = 0; i < n; ++i)
+        out[i] = res[i] ? G1(reinterpret_cast<void*>(res[i])) : G1();
+}
+
+G1 G1::mulSum(const G1 *els, const ShortScalar *m, size_t n) {
+    std::vector<element_ptr> _els;
+    std::vector<uint64_t> _m;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d && !m[i].isNull()) {
+            _els.push_back(reinterpret_cast<element_ptr>(els[i].d->p));
+            _m.push_back(m[i].getValue());
+        }
+    }
+    element_ptr _el = new element_s;
+    element_init_G1(_el, p_params);
+    if ((!short_combination(_el, _els, _m, false)) || element_is0(_el)) {
+        freeElement(_el);
+        return G1();
+    }
+    return G1(reinterpret_cast<void*>(_el));
+}
+
 int G1::getDataLen(bool compressed) {
     if (compressed) {
         return pairing_length_in_bytes_x_only_G1(p_params) + 1;
@@ -2256,35 +3639,75 @@ int G1::getDataLen(bool compressed) {
 }
 
 G1 G1::getValue(const char *data, bool compressed) {
-    // Note: const keyword simply missing in element_from_bytes_[...]
-    element_ptr _el;
-    if (compressed) {
-        int lsb = (int) *(data++);
-        if (lsb == NULL_ELEMENT_BYTE_VALUE)
-            return G1();
-        _el = new element_s;
-        element_init_G1(_el, p_params);
-        element_from_bytes_x_only(_el, reinterpret_cast<unsigned char*>(
-                                      const_cast<char*>(data)));
-        if (lsb != ((element_sign(element_y(_el)) > 0) ? 1 : 0))
-            element_neg(_el, _el);
-    } else {
-        _el = new element_s;
-        element_init_G1(_el, p_params);
-        element_from_bytes(_el, reinterpret_cast<unsigned char*>(
-                                      const_cast<char*>(data)));
-        if (element_is0(_el)) {
-            freeElement(_el);
-            return G1();
+    G1 result;
+    if (compressed && g1Cache.find(data, getDataLen(true), result))
+        return result;
+    element_t _proto;
+    element_init_G1(_proto, p_params);
+    element_ptr _el = decode_point(data, compressed, _proto);
+    element_clear(_proto);
+    if (!_el)
+        return G1();
+    result = G1(reinterpret_cast<void*>(_el));
+    if (compressed)
+        g1Cache.insert(data, getDataLen(true), result);
+    return result;
+}
+
+void G1::serializeMany(const G1 *els, size_t n, char *data,
+                        bool compressed) {
+    int len = getDataLen(compressed);
+    /* Compressed null elements only set the first byte of their slot */
+    memset(data, 0, n * len);
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i].getData(data, compressed);
+}
+
+void G1::deserializeMany(const char *data, size_t n, G1 *els,
+                          bool compressed, int threads) {
+    int len = getDataLen(compressed);
+    // Note: The workers only decode raw elements, while the cache and the
+    // shared data (with its reference counters) are only used here
+    std::vector<bool> todo(n, true);
+    for (size_t i = 0; compressed && (i < n); ++i) {
+        if (*(data + i * len) == NULL_ELEMENT_BYTE_VALUE) {
+            els[i] = G1();
+            todo[i] = false;
+        } else if (g1Cache.find(data + i * len, len, els[i])) {
+            todo[i] = false;
         }
     }
-    return G1(reinterpret_cast<void*>(_el));
+    std::vector<element_ptr> res(n, NULL);
+    element_t _proto;
+    element_init_G1(_proto, p_params);
+    decode_points(data, len, compressed, _proto, todo, res, threads);
+    element_clear(_proto);
+    for (size_t i = 0; i < n; ++i) {
+        if (!todo[i]) continue;
+        if (!res[i]) {
+            els[i] = G1();
+            continue;
+        }
+        els[i] = G1(reinterpret_cast<void*>(res[i]));
+        if (compressed)
+            g1Cache.insert(data + i * len, len, els[i]);
+    }
+}
+
+void G1::normalizeMany(const G1 *, size_t) {
+    // Note: PBC always keeps the points in affine coordinates
 }
 
 G1 G1::fromHash(const char *data, int len) {
+    char s[HASH_LEN_BYTES];
+    getHash(data, len, s);
+    return fromHash(s);
+}
+
+G1 G1::fromHash(const char *hash) {
     element_ptr _el = new element_s;
     element_init_G1(_el, p_params);
-    element_from_unhashed_data(data, len, _el);
+    sw_map(_el, hash);
     // Following is very unlikely, but we still want to handle it
     if (UNLIKELY(element_is0(_el))) {
         freeElement(_el);
@@ -2293,24 +3716,83 @@ G1 G1::fromHash(const char *data, int len) {
     return G1(reinterpret_cast<void*>(_el));
 }
 
-G1 G1::fromHash(const char *hash) {
+void G1::fromHashMany(const char **data, const int *len, int n, G1 *els) {
+    if (n <= 0) return;
+    char *hashes = new char[n * HASH_LEN_BYTES];
+    getHashMany(data, len, n, hashes);
+    for (int i = 0; i < n; ++i)
+        els[i] = fromHash(hashes + i * HASH_LEN_BYTES);
+    delete[] hashes;
+}
+
+void G1::deref() {
+    if (d->c) {
+        --d->c;
+    } else {
+        freeElement(d->p);
+        delete d;
+    }
+}
+
+G1JointTable::G1JointTable(const G1 &a, const G1 &b) {
+    element_t _a, _b;
+    element_init_G1(_a, p_params);
+    element_init_G1(_b, p_params);
+    if (a.d)
+        element_set(_a, reinterpret_cast<element_ptr>(a.d->p));
+    else
+        element_set0(_a);
+    if (b.d)
+        element_set(_b, reinterpret_cast<element_ptr>(b.d->p));
+    else
+        element_set0(_b);
+    d = new SharedData(reinterpret_cast<void*>(joint_init(_a, _b)));
+    element_clear(_a);
+    element_clear(_b);
+}
+
+G1 G1JointTable::mult(const Fp &x, const Fp &y) const {
     element_ptr _el = new element_s;
     element_init_G1(_el, p_params);
-    // Note: const keyword simply missing in element_from_hash
-    element_from_hash(_el, const_cast<char*>(hash), HASH_LEN_BYTES);
-    // Following is very unlikely, but we still want to handle it
-    if (UNLIKELY(element_is0(_el))) {
+    joint_mult(_el, reinterpret_cast<JointTable*>(d->p),
+               reinterpret_cast<element_ptr>(x.d->p),
+               reinterpret_cast<element_ptr>(y.d->p));
+    if (element_is0(_el)) {
         freeElement(_el);
         return G1();
     }
     return G1(reinterpret_cast<void*>(_el));
 }
 
-void G1::deref() {
+void G1JointTable::multMany(const Fp *x, const Fp *y, size_t n, G1 *out,
+                            int threads) const {
+    const JointTable *_tab = reinterpret_cast<JointTable*>(d->p);
+    // Note: The workers only deal with raw elements, since the reference
+    // counters of the shared data are not thread-safe
+    std::vector<element_ptr> res(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            res[i] = new element_s;
+            element_init_G1(res[i], p_params);
+            joint_mult(res[i], _tab, reinterpret_cast<element_ptr>(x[i].d->p),
+                       reinterpret_cast<element_ptr>(y[i].d->p));
+        }
+    });
+    for (size_t i = 0; i < n; ++i) {
+        if (element_is0(res[i])) {
+            freeElement(res[i]);
+            out[i] = G1();
+        } else {
+            out[i] = G1(reinterpret_cast<void*>(res[i]));
+        }
+    }
+}
+
+void G1JointTable::deref() {
     if (d->c) {
         --d->c;
     } else {
-        freeElement(d->p);
+        joint_clear(reinterpret_cast<JointTable*>(d->p));
         delete d;
     }
 }
@@ -2589,9 +4071,13 @@ void G2::loadPairingPrecomputations(char *data) {
 }
 
 G2 G2::getRand() {
+    element_t r;
+    element_init_Zr(r, p_params);
+    element_random(r);
     element_ptr _el = new element_s;
     element_init_G2(_el, p_params);
-    element_random(_el);
+    element_pp_pow_zn(_el, r, rnd_base_g2);
+    element_clear(r);
     // Following is very unlikely, but we still want to handle it
     if (UNLIKELY(element_is0(_el))) {
         freeElement(_el);
@@ -2600,6 +4086,50 @@ G2 G2::getRand() {
     return G2(reinterpret_cast<void*>(_el));
 }
 
+void G2::getRandMany(G2 *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
+}
+
+void G2::mulMany(const G2 *els, size_t n, const Fp &m, G2 *out,
+                 int threads) {
+    const element_ptr &_m = reinterpret_cast<element_ptr>(m.d->p);
+    if ((m.d == Fp::one) || (m.d == Fp::zero) ||
+            element_is1(_m) || element_is0(_m)) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = els[i] * m;
+        return;
+    }
+    std::vector<element_ptr> res(n);
+    for (size_t i = 0; i < n; ++i)
+        res[i] = els[i].d ? reinterpret_cast<element_ptr>(els[i].d->p) : NULL;
+    mapElements(res, threads, [&](element_ptr r, element_ptr p) {
+        element_mul_zn(r, p, _m);
+    });
+    // Note: Since neither the elements nor the scalar are null,
+    // the results won't be null either.
+    for (size_t i = 0; i < n; ++i)
+        out[i] = res[i] ? G2(reinterpret_cast<void*>(res[i])) : G2();
+}
+
+G2 G2::mulSum(const G2 *els, const ShortScalar *m, size_t n) {
+    std::vector<element_ptr> _els;
+    std::vector<uint64_t> _m;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d && !m[i].isNull()) {
+            _els.push_back(reinterpret_cast<element_ptr>(els[i].d->p));
+            _m.push_back(m[i].getValue());
+        }
+    }
+    element_ptr _el = new element_s;
+    element_init_G2(_el, p_params);
+    if ((!short_combination(_el, _els, _m, false)) || element_is0(_el)) {
+        freeElement(_el);
+        return G2();
+    }
+    return G2(reinterpret_cast<void*>(_el));
+}
+
 int G2::getDataLen(bool compressed) {
     if (compressed) {
         return pairing_length_in_bytes_x_only_G2(p_params) + 1;
@@ -2609,29 +4139,59 @@ int G2::getDataLen(bool compressed) {
 }
 
 G2 G2::getValue(const char *data, bool compressed) {
-    // Note: const keyword simply missing in element_from_bytes_[...]
-    element_ptr _el;
-    if (compressed) {
-        int lsb = (int) *(data++);
-        if (lsb == NULL_ELEMENT_BYTE_VALUE)
-            return G2();
-        _el = new element_s;
-        element_init_G2(_el, p_params);
-        element_from_bytes_x_only(_el, reinterpret_cast<unsigned char*>(
-                                      const_cast<char*>(data)));
-        if (lsb != ((element_sign(element_y(_el)) > 0) ? 1 : 0))
-            element_neg(_el, _el);
-    } else {
-        _el = new element_s;
-        element_init_G2(_el, p_params);
-        element_from_bytes(_el, reinterpret_cast<unsigned char*>(
-                                      const_cast<char*>(data)));
-        if (element_is0(_el)) {
-            freeElement(_el);
-            return G2();
+    G2 result;
+    if (compressed && g2Cache.find(data, getDataLen(true), result))
+        return result;
+    element_t _proto;
+    element_init_G2(_proto, p_params);
+    element_ptr _el = decode_point(data, compressed, _proto);
+    element_clear(_proto);
+    if (!_el)
+        return G2();
+    result = G2(reinterpret_cast<void*>(_el));
+    if (compressed)
+        g2Cache.insert(data, getDataLen(true), result);
+    return result;
+}
+
+void G2::serializeMany(const G2 *els, size_t n, char *data,
+                        bool compressed) {
+    int len = getDataLen(compressed);
+    /* Compressed null elements only set the first byte of their slot */
+    memset(data, 0, n * len);
+    for (size_t i = 0; i < n; ++i, data += len)
+        els[i].getData(data, compressed);
+}
+
+void G2::deserializeMany(const char *data, size_t n, G2 *els,
+                          bool compressed, int threads) {
+    int len = getDataLen(compressed);
+    // Note: The workers only decode raw elements, while the cache and the
+    // shared data (with its reference counters) are only used here
+    std::vector<bool> todo(n, true);
+    for (size_t i = 0; compressed && (i < n); ++i) {
+        if (*(data + i * len) == NULL_ELEMENT_BYTE_VALUE) {
+            els[i] = G2();
+            todo[i] = false;
+        } else if (g2Cache.find(data + i * len, len, els[i])) {
+            todo[i] = false;
         }
     }
-    return G2(reinterpret_cast<void*>(_el));
+    std::vector<element_ptr> res(n, NULL);
+    element_t _proto;
+    element_init_G2(_proto, p_params);
+    decode_points(data, len, compressed, _proto, todo, res, threads);
+    element_clear(_proto);
+    for (size_t i = 0; i < n; ++i) {
+        if (!todo[i]) continue;
+        if (!res[i]) {
+            els[i] = G2();
+            continue;
+        }
+        els[i] = G2(reinterpret_cast<void*>(res[i]));
+        if (compressed)
+            g2Cache.insert(data + i * len, len, els[i]);
+    }
 }
 
 G2 G2::fromHash(const char *data, int len) {
@@ -2668,6 +4228,69 @@ void G2::deref() {
     }
 }
 
+G2JointTable::G2JointTable(const G2 &a, const G2 &b) {
+    element_t _a, _b;
+    element_init_G2(_a, p_params);
+    element_init_G2(_b, p_params);
+    if (a.d)
+        element_set(_a, reinterpret_cast<element_ptr>(a.d->p));
+    else
+        element_set0(_a);
+    if (b.d)
+        element_set(_b, reinterpret_cast<element_ptr>(b.d->p));
+    else
+        element_set0(_b);
+    d = new SharedData(reinterpret_cast<void*>(joint_init(_a, _b)));
+    element_clear(_a);
+    element_clear(_b);
+}
+
+G2 G2JointTable::mult(const Fp &x, const Fp &y) const {
+    element_ptr _el = new element_s;
+    element_init_G2(_el, p_params);
+    joint_mult(_el, reinterpret_cast<JointTable*>(d->p),
+               reinterpret_cast<element_ptr>(x.d->p),
+               reinterpret_cast<element_ptr>(y.d->p));
+    if (element_is0(_el)) {
+        freeElement(_el);
+        return G2();
+    }
+    return G2(reinterpret_cast<void*>(_el));
+}
+
+void G2JointTable::multMany(const Fp *x, const Fp *y, size_t n, G2 *out,
+                            int threads) const {
+    const JointTable *_tab = reinterpret_cast<JointTable*>(d->p);
+    // Note: The workers only deal with raw elements, since the reference
+    // counters of the shared data are not thread-safe
+    std::vector<element_ptr> res(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            res[i] = new element_s;
+            element_init_G2(res[i], p_params);
+            joint_mult(res[i], _tab, reinterpret_cast<element_ptr>(x[i].d->p),
+                       reinterpret_cast<element_ptr>(y[i].d->p));
+        }
+    });
+    for (size_t i = 0; i < n; ++i) {
+        if (element_is0(res[i])) {
+            freeElement(res[i]);
+            out[i] = G2();
+        } else {
+            out[i] = G2(reinterpret_cast<void*>(res[i]));
+        }
+    }
+}
+
+void G2JointTable::deref() {
+    if (d->c) {
+        --d->c;
+    } else {
+        joint_clear(reinterpret_cast<JointTable*>(d->p));
+        delete d;
+    }
+}
+
 GT GT::operator*(const GT &other) const {
     if (!d) return other;
     if (!other.d) return *this;
@@ -2802,7 +4425,9 @@ bool GT::operator==(const GT &other) const {
     return !element_cmp(_this, _other);
 }
 
-void GT::getData(char *data) const {
+void GT::getData(char *data, bool compressed) const {
+    if (UNLIKELY(compressed))
+        throw "GT compression is not available with PBC";
     if (!d) {
         element_t one;
         element_init_GT(one, p_params);
@@ -2902,9 +4527,13 @@ void GT::loadPowerPrecomputations(char *data) {
 }
 
 GT GT::getRand() {
+    element_t r;
+    element_init_Zr(r, p_params);
+    element_random(r);
     element_ptr _el = new element_s;
     element_init_GT(_el, p_params);
-    element_random(_el);
+    element_pp_pow_zn(_el, r, rnd_base_gt);
+    element_clear(r);
     // Following is very unlikely, but we still want to handle it
     if (UNLIKELY(element_is1(_el))) {
         freeElement(_el);
@@ -2913,11 +4542,59 @@ GT GT::getRand() {
     return GT(reinterpret_cast<void*>(_el));
 }
 
-int GT::getDataLen() {
+void GT::getRandMany(GT *els, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        els[i] = getRand();
+}
+
+void GT::powMany(const GT *els, size_t n, const Fp &m, GT *out,
+                 int threads) {
+    const element_ptr &_m = reinterpret_cast<element_ptr>(m.d->p);
+    if ((m.d == Fp::one) || (m.d == Fp::zero) ||
+            element_is1(_m) || element_is0(_m)) {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = els[i] ^ m;
+        return;
+    }
+    std::vector<element_ptr> res(n);
+    for (size_t i = 0; i < n; ++i)
+        res[i] = els[i].d ? reinterpret_cast<element_ptr>(els[i].d->p) : NULL;
+    mapElements(res, threads, [&](element_ptr r, element_ptr p) {
+        element_mul_zn(r, p, _m);
+    });
+    // Note: Since neither the elements nor the scalar are null,
+    // the results won't be null either.
+    for (size_t i = 0; i < n; ++i)
+        out[i] = res[i] ? GT(reinterpret_cast<void*>(res[i])) : GT();
+}
+
+GT GT::powProd(const GT *els, const ShortScalar *m, size_t n) {
+    std::vector<element_ptr> _els;
+    std::vector<uint64_t> _m;
+    for (size_t i = 0; i < n; ++i) {
+        if (els[i].d && !m[i].isNull()) {
+            _els.push_back(reinterpret_cast<element_ptr>(els[i].d->p));
+            _m.push_back(m[i].getValue());
+        }
+    }
+    element_ptr _el = new element_s;
+    element_init_GT(_el, p_params);
+    if ((!short_combination(_el, _els, _m, true)) || element_is1(_el)) {
+        freeElement(_el);
+        return GT();
+    }
+    return GT(reinterpret_cast<void*>(_el));
+}
+
+int GT::getDataLen(bool compressed) {
+    if (UNLIKELY(compressed))
+        throw "GT compression is not available with PBC";
     return pairing_length_in_bytes_GT(p_params);
 }
 
-GT GT::getValue(const char *data) {
+GT GT::getValue(const char *data, bool compressed) {
+    if (UNLIKELY(compressed))
+        throw "GT compression is not available with PBC";
     // Note: const keyword simply missing in element_from_bytes
     element_ptr _el = new element_s;
     element_init_GT(_el, p_params);
@@ -6,10 +6,16 @@
 #ifndef PAIRINGS_H
 #define PAIRINGS_H
 
+#include <cstdint>
 #include <iostream>
 #include <utility>
 #include <vector>
 
+#ifdef LIB_COMPILATION
+/* Leading byte of the compressed data of a null G1 or G2 element */
+#define NULL_ELEMENT_BYTE_VALUE 2
+#endif
+
 /**
  * @file pairings.h
  * @brief Pairing-based cryptography wrapper - @ref pairings namespace.
@@ -46,10 +52,14 @@ namespace pairings {
  * You must call this function exactly once before using this
  * namespace. You may call it again after having called
  * terminate_pairings().
+ * Note that the random values used afterwards do not depend on
+ * @p data: they come from the per-thread generator described in
+ * setRandomSeed(const char*,int), which is seeded from the operating
+ * system unless that function is called.
  *
  * @param len Length of the data pointed to by @p data.
- * @param data With MIRACL: Pointer to some random data used to
- *   initialize the pseudo-random number generator.
+ * @param data With MIRACL: Pointer to some random data only used to
+ *   pick the initial bases of the groups.
  *   Data from `/dev/random` or `/dev/urandom` might be used under Linux.
  *   With PBC: Text data containing the curve parameters
  *   to build up the pairing groups and primitives.
@@ -64,6 +74,40 @@ void initialize_pairings(int len, const char *data);
  */
 void terminate_pairings();
 
+/**
+ * @brief Sets the number of decompressed points to keep in cache.
+ *
+ * When the capacity is not zero, the functions
+ * @ref G1::getValue(const char*,bool) and
+ * @ref G2::getValue(const char*,bool) keep the last points they
+ * decompressed, indexed by their compressed data, so that the points
+ * that keep reappearing (such as CRS elements or public keys) are only
+ * decompressed once. There is one cache of @p capacity points for
+ * each group, and the least recently used points are dropped first.
+ *
+ * @note The cache is disabled (capacity 0) by default. Like the rest
+ *   of the library, it is not thread-safe.
+ * @param capacity Maximal number of points in each cache.
+ */
+void setPointCacheSize(size_t capacity);
+
+/**
+ * @brief Seeds the random generator of the calling thread.
+ *
+ * Random values are drawn from a buffered ChaCha20 generator, of
+ * which each thread has its own instance, seeded from the operating
+ * system the first time it is used. This function seeds it instead
+ * from the data @p seed, so that the same sequence of calls gives
+ * the same random values; this is useful to reproduce tests or
+ * benchmarks exactly.
+ *
+ * @warning The random values are then predictable, so this function
+ *   should never be called before producing proofs to be published.
+ * @param seed Pointer to the seed data.
+ * @param len Length of the seed data.
+ */
+void setRandomSeed(const char *seed, int len);
+
 /**
  * @cond INTERNAL_DATA_STRUCT
  */
@@ -77,9 +121,12 @@ struct SharedData {
  */
 
 class Fp;
+class ShortScalar;
 class G1;
 class G2;
 class GT;
+class G1JointTable;
+class G2JointTable;
 
 /**
  * @brief Gets the length of a hash.
@@ -105,6 +152,79 @@ int getHashLen();
  */
 void getHash(const char *data, int len, char *hash);
 
+/**
+ * @brief Hashes several independent messages.
+ *
+ * This gives the same hashes as calling
+ * getHash(const char*,int,char*) on each message, but lets the
+ * implementation hash several messages at once in the lanes of
+ * vector registers when the processor allows it.
+ *
+ * The hash of the i-th message is stored at
+ * @p hash + i * getHashLen(), so that @p hash should point to some
+ * accessible space containing at least @p n * getHashLen()
+ * available bytes.
+ *
+ * @param data Pointers to the messages to hash.
+ * @param len Lengths of the messages to hash.
+ * @param n Number of messages.
+ * @param hash Pointer to where the hashes are to be stored.
+ * @sa getHashLen()
+ */
+void getHashMany(const char **data, const int *len, int n, char *hash);
+
+/**
+ * @brief State of an incremental hash computation.
+ *
+ * Its content is private to the hashing functions: a state is
+ * prepared with hashInit(), fed with hashUpdate() and consumed
+ * with hashFinal().
+ */
+struct HashContext {
+    /**
+     * @cond INTERNAL_DATA_STRUCT
+     */
+    uint64_t data[26];
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief Starts an incremental hash computation.
+ * @param ctx State to initialize.
+ * @sa hashUpdate(HashContext&,const char*,int)
+ * @sa hashFinal(HashContext&,char*)
+ */
+void hashInit(HashContext &ctx);
+
+/**
+ * @brief Appends some data to an incremental hash computation.
+ *
+ * Feeding some data in several calls to this function gives the
+ * same hash as feeding it all at once to
+ * getHash(const char*,int,char*).
+ *
+ * @param ctx State of the computation.
+ * @param data Pointer to the data to hash.
+ * @param len Length of the data to hash.
+ */
+void hashUpdate(HashContext &ctx, const char *data, int len);
+
+/**
+ * @brief Ends an incremental hash computation.
+ *
+ * The parameter @p hash should point to some accessible space
+ * containing at least getHashLen() available bytes.
+ * The state @p ctx has to be initialized again with
+ * hashInit(HashContext&) before being reused.
+ *
+ * @param ctx State of the computation.
+ * @param hash Pointer to where the hash is to be stored.
+ * @sa getHashLen()
+ */
+void hashFinal(HashContext &ctx, char *hash);
+
 /**
  * @brief Checks if the underlying library handles precomputations.
  * @return `true` if precomputations are supported, `false` otherwise.
@@ -115,6 +235,22 @@ inline bool hasPrecomputations() { return false; }
 bool hasPrecomputations();
 #endif
 
+/**
+ * @brief Checks if the underlying library can compress elements
+ *   of @f$\mathbb{G}_T@f$.
+ *
+ * When this returns `false`, the functions of GT and BT that take a
+ * `compressed` parameter throw an exception if it is set.
+ *
+ * @return `true` if GT compression is supported, `false` otherwise.
+ * @sa GT::getData(char*,bool)
+ */
+#if defined(USE_PBC) && !defined(LIB_COMPILATION)
+inline bool hasGTCompression() { return false; }
+#else
+bool hasGTCompression();
+#endif
+
 /**
  * @brief Checks if the iostream implementations supports threads.
  *
@@ -139,9 +275,12 @@ bool iostream_nothreads();
  * @ref pairings.
  */
 class Fp {
+    friend class ShortScalar;
     friend class G1;
     friend class G2;
     friend class GT;
+    friend class G1JointTable;
+    friend class G2JointTable;
     friend void initialize_pairings(int len, const char *rndData);
     friend void terminate_pairings();
     friend G1 operator*(const Fp &m, const G1 &g);
@@ -314,6 +453,16 @@ public:
      * @return A random element value.
      */
     static Fp getRand();
+    /**
+     * @brief Gets several random elements.
+     *
+     * This is equivalent to calling Fp::getRand() @p n times.
+     *
+     * @param els Array of @p n elements where the results are stored.
+     * @param n Number of elements.
+     * @sa Fp::getRand()
+     */
+    static void getRandMany(Fp *els, size_t n);
     /**
      * @brief Gets the length of an element's data.
      *
@@ -337,6 +486,29 @@ public:
      * @sa Fp::getData(char*)
      */
     static Fp getValue(const char *data);
+    /**
+     * @brief Retrieves the data of several elements at once.
+     *
+     * The data of the elements is written contiguously, each of them
+     * taking exactly @ref Fp::getDataLen() bytes, so that @p data should
+     * point to some accessible space containing at least
+     * `n * Fp::getDataLen()` available bytes.
+     *
+     * @param els Array of the elements.
+     * @param n Number of elements.
+     * @param data Pointer to where the data is to be stored.
+     * @sa Fp::deserializeMany(const char*,size_t,Fp*)
+     */
+    static void serializeMany(const Fp *els, size_t n, char *data);
+    /**
+     * @brief Gets the values of several elements from their data.
+     * @param data Pointer to the data, as given by
+     *   @ref Fp::serializeMany(const Fp*,size_t,char*).
+     * @param n Number of elements.
+     * @param els Array where the @p n element values are to be stored.
+     * @sa Fp::serializeMany(const Fp*,size_t,char*)
+     */
+    static void deserializeMany(const char *data, size_t n, Fp *els);
     /**
      * @brief Gets an element value from some data to hash.
      *
@@ -372,6 +544,66 @@ private:
     SharedData *d;
 };
 
+/**
+ * @brief Short scalars, for the coefficients of random linear combinations.
+ *
+ * Objects of this class represent integers in @f$[0,2^{64})@f$, seen as
+ * elements of @f$\mathbb{F}_p@f$. Multiplying a group element by such
+ * a scalar takes about a quarter of the time of a multiplication by a
+ * random @ref Fp element, and 64-bit coefficients are enough to merge
+ * several equations into a single randomized check: a wrong equation
+ * then goes unnoticed with probability at most @f$2^{-64}@f$.
+ *
+ * @sa G1::mulSum(const G1*,const ShortScalar*,size_t)
+ */
+class ShortScalar {
+public:
+    /**
+     * @brief Constructs a new null scalar.
+     */
+    inline ShortScalar();
+    /**
+     * @brief Constructs a new scalar from its value.
+     * @param v The scalar value.
+     */
+    inline explicit ShortScalar(uint64_t v);
+    /**
+     * @brief Gets the value of this scalar.
+     * @return The scalar value.
+     */
+    inline uint64_t getValue() const;
+    /**
+     * @brief Checks if this scalar is null.
+     * @return `true` if this scalar is null, `false` otherwise.
+     */
+    inline bool isNull() const;
+    /**
+     * @brief Converts this scalar to an element of @f$\mathbb{F}_p@f$.
+     * @return The corresponding element.
+     */
+    Fp toFp() const;
+    /**
+     * @brief Gets a random scalar.
+     *
+     * The random generator is the same as for Fp::getRand().
+     *
+     * @return A random scalar value.
+     */
+    static ShortScalar getRand();
+    /**
+     * @brief Gets several random scalars.
+     *
+     * This is equivalent to calling ShortScalar::getRand() @p n times.
+     *
+     * @param els Array of @p n scalars where the results are stored.
+     * @param n Number of scalars.
+     * @sa ShortScalar::getRand()
+     */
+    static void getRandMany(ShortScalar *els, size_t n);
+private:
+    uint64_t v;
+};
+
 /**
  * @brief The @f$\mathbb{G}_1@f$ class.
  *
@@ -379,6 +611,7 @@ private:
  */
 class G1 {
     friend class GT;
+    friend class G1JointTable;
 public:
     /**
      * @brief Constructs a new null element.
@@ -447,6 +680,25 @@ public:
      * @return Product @f$m\cdot g@f$
      */
     friend G1 operator*(const Fp &m, const G1 &g);
+    /**
+     * @brief Inplace multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return Reference to the modified element.
+     */
+    G1 &operator*=(const ShortScalar &other);
+    /**
+     * @brief Multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return The product of the two elements.
+     */
+    G1 operator*(const ShortScalar &other) const;
+    /**
+     * @brief Multiplication operator.
+     * @param m Short scalar value.
+     * @param g Element value.
+     * @return Product @f$m\cdot g@f$
+     */
+    friend G1 operator*(const ShortScalar &m, const G1 &g);
     /**
      * @brief Equality operator.
      * @param other Value with which to compare the current element.
@@ -597,6 +849,48 @@ public:
      * @return A random element value.
      */
     static G1 getRand();
+    /**
+     * @brief Gets several random elements.
+     *
+     * This is equivalent to calling G1::getRand() @p n times, but
+     * shares the cost of drawing the random values. The points
+     * are then normalized together, with a single inversion.
+     *
+     * @param els Array of @p n elements where the results are stored.
+     * @param n Number of elements.
+     * @sa G1::getRand()
+     */
+    static void getRandMany(G1 *els, size_t n);
+    /**
+     * @brief Multiplies several elements by the same scalar.
+     *
+     * This is equivalent to setting each @p out[i] to
+     * @p els[i] * @p m. With PBC, the GLV split of the scalar is done
+     * once for all the elements, and the elements can be spread over
+     * several threads. With MIRACL, this is a plain loop.
+     * The arrays @p els and @p out may be the same.
+     *
+     * @param els Array of @p n elements to multiply.
+     * @param n Number of elements.
+     * @param m Scalar by which to multiply.
+     * @param out Array of @p n elements where the results are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see G1JointTable::multMany).
+     */
+    static void mulMany(const G1 *els, size_t n, const Fp &m, G1 *out,
+                        int threads = 1);
+    /**
+     * @brief Computes a linear combination with short scalars.
+     *
+     * This is equivalent to summing the @p m[i] * @p els[i], but all
+     * the terms share the same doublings.
+     *
+     * @param els Array of @p n elements.
+     * @param m Array of @p n short scalars.
+     * @param n Number of terms.
+     * @return The sum @f$\sum_i m_i\cdot els_i@f$.
+     */
+    static G1 mulSum(const G1 *els, const ShortScalar *m, size_t n);
     /**
      * @brief Gets the length of an element's data.
      *
@@ -621,6 +915,8 @@ public:
      * @p data should hold exactly what the function
      * @ref G1::getData(char*,bool) gives for the element
      * to be reconstructed, for the same value of @p compressed.
+     * Uncompressed data that does not describe a point of the curve
+     * gives the null element.
      *
      * @param data Pointer to the data.
      * @param compressed Whether the data was compressed or not.
@@ -629,6 +925,57 @@ public:
      * @sa G1::getData(char*,bool)
      */
     static G1 getValue(const char *data, bool compressed = false);
+    /**
+     * @brief Retrieves the data of several elements at once.
+     *
+     * The data of the elements is written contiguously, each of them
+     * taking exactly @ref G1::getDataLen(bool) bytes, so that @p data
+     * should point to some accessible space containing at least
+     * `n * G1::getDataLen(compressed)` available bytes.
+     *
+     * @note This is faster than calling @ref G1::getData(char*,bool)
+     * for each element when the elements need to be converted to affine
+     * coordinates first, since this conversion is then done with a
+     * single field inversion for all of them.
+     *
+     * @param els Array of the elements.
+     * @param n Number of elements.
+     * @param data Pointer to where the data is to be stored.
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
+     * @sa G1::deserializeMany(const char*,size_t,G1*,bool,int)
+     */
+    static void serializeMany(const G1 *els, size_t n, char *data,
+                              bool compressed = false);
+    /**
+     * @brief Gets the values of several elements from their data.
+     * @param data Pointer to the data, as given by
+     *   @ref G1::serializeMany(const G1*,size_t,char*,bool).
+     * @param n Number of elements.
+     * @param els Array where the @p n element values are to be stored.
+     * @param compressed Whether the data was compressed or not.
+     * @param threads Number of threads among which the decoding is
+     *   split, with PBC (see G1JointTable::multMany). With MIRACL,
+     *   this is a plain loop.
+     * @sa G1::serializeMany(const G1*,size_t,char*,bool)
+     */
+    static void deserializeMany(const char *data, size_t n, G1 *els,
+                                bool compressed = false, int threads = 1);
+    /**
+     * @brief Converts several elements to affine coordinates at once.
+     *
+     * This does not change the values of the elements, but makes
+     * their later serialization cheaper: the conversion is done with
+     * a single field inversion for all of them, as in
+     * @ref G1::serializeMany(const G1*,size_t,char*,bool).
+     *
+     * @note Does nothing when the implementation always keeps the
+     *   elements in affine coordinates.
+     *
+     * @param els Array of the elements.
+     * @param n Number of elements.
+     */
+    static void normalizeMany(const G1 *els, size_t n);
     /**
      * @brief Gets an element value from some data to hash.
      *
@@ -649,12 +996,35 @@ public:
      * bytes long, as would the getHash(const char*,int,char*)
      * function generate.
      *
+     * The hash is mapped to the curve with the Shallue-van de
+     * Woestijne encoding, which takes the same number of field
+     * operations for every hash value. With PBC, this needs a curve
+     * y^2 = x^3 + b without cofactor (such as BN curves); on other
+     * curves, PBC's own try-and-increment method is used instead.
+     *
      * @param hash A hash value.
      * @return Element generated from the hash value.
      * @sa getHashLen()
      * @sa getHash(const char*,int,char*)
      */
     static G1 fromHash(const char *hash);
+    /**
+     * @brief Gets the element values from several data to hash.
+     *
+     * This gives the same elements as calling
+     * G1::fromHash(const char*,int) on each message, but hashes them
+     * with getHashMany(const char**,const int*,int,char*) and, when
+     * the implementation allows it, shares the field inversions of
+     * the map among all the messages.
+     *
+     * @param data Pointers to the data to hash.
+     * @param len Lengths of the data to hash.
+     * @param n Number of messages.
+     * @param els Array of @p n elements where the results are stored.
+     * @sa G1::fromHash(const char*,int)
+     */
+    static void fromHashMany(const char **data, const int *len, int n,
+                             G1 *els);
 private:
     inline explicit G1(void *v);
     inline explicit G1(SharedData *d);
@@ -670,6 +1040,7 @@ private:
  */
 class G2 {
     friend class GT;
+    friend class G2JointTable;
 public:
     /**
      * @brief Constructs a new null element.
@@ -738,6 +1109,25 @@ public:
      * @return Product @f$m\cdot g@f$
      */
     friend G2 operator*(const Fp &m, const G2 &g);
+    /**
+     * @brief Inplace multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return Reference to the modified element.
+     */
+    G2 &operator*=(const ShortScalar &other);
+    /**
+     * @brief Multiplication operator.
+     * @param other Short scalar to multiply with the current element.
+     * @return The product of the two elements.
+     */
+    G2 operator*(const ShortScalar &other) const;
+    /**
+     * @brief Multiplication operator.
+     * @param m Short scalar value.
+     * @param g Element value.
+     * @return Product @f$m\cdot g@f$
+     */
+    friend G2 operator*(const ShortScalar &m, const G2 &g);
     /**
      * @brief Equality operator.
      * @param other Value with which to compare the current element.
@@ -954,6 +1344,46 @@ public:
      * @return A random element value.
      */
     static G2 getRand();
+    /**
+     * @brief Gets several random elements.
+     *
+     * This is equivalent to calling G2::getRand() @p n times, but
+     * shares the cost of drawing the random values.
+     *
+     * @param els Array of @p n elements where the results are stored.
+     * @param n Number of elements.
+     * @sa G2::getRand()
+     */
+    static void getRandMany(G2 *els, size_t n);
+    /**
+     * @brief Multiplies several elements by the same scalar.
+     *
+     * This is equivalent to setting each @p out[i] to
+     * @p els[i] * @p m. With PBC, the elements can be spread over
+     * several threads; otherwise, this is a plain loop.
+     * The arrays @p els and @p out may be the same.
+     *
+     * @param els Array of @p n elements to multiply.
+     * @param n Number of elements.
+     * @param m Scalar by which to multiply.
+     * @param out Array of @p n elements where the results are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see G1JointTable::multMany).
+     */
+    static void mulMany(const G2 *els, size_t n, const Fp &m, G2 *out,
+                        int threads = 1);
+    /**
+     * @brief Computes a linear combination with short scalars.
+     *
+     * This is equivalent to summing the @p m[i] * @p els[i], but all
+     * the terms share the same doublings.
+     *
+     * @param els Array of @p n elements.
+     * @param m Array of @p n short scalars.
+     * @param n Number of terms.
+     * @return The sum @f$\sum_i m_i\cdot els_i@f$.
+     */
+    static G2 mulSum(const G2 *els, const ShortScalar *m, size_t n);
     /**
      * @brief Gets the length of an element's data.
      *
@@ -978,6 +1408,8 @@ public:
      * @p data should hold exactly what the function
      * @ref G2::getData(char*,bool) gives for the element
      * to be reconstructed, for the same value of @p compressed.
+     * Uncompressed data that does not describe a point of the curve
+     * gives the null element.
      *
      * @param data Pointer to the data.
      * @param compressed Whether the data was compressed or not.
@@ -986,6 +1418,37 @@ public:
      * @sa G2::getData(char*,bool)
      */
     static G2 getValue(const char *data, bool compressed = false);
+    /**
+     * @brief Retrieves the data of several elements at once.
+     *
+     * The data of the elements is written contiguously, each of them
+     * taking exactly @ref G2::getDataLen(bool) bytes, so that @p data
+     * should point to some accessible space containing at least
+     * `n * G2::getDataLen(compressed)` available bytes.
+     *
+     * @param els Array of the elements.
+     * @param n Number of elements.
+     * @param data Pointer to where the data is to be stored.
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
+     * @sa G2::deserializeMany(const char*,size_t,G2*,bool,int)
+     */
+    static void serializeMany(const G2 *els, size_t n, char *data,
+                              bool compressed = false);
+    /**
+     * @brief Gets the values of several elements from their data.
+     * @param data Pointer to the data, as given by
+     *   @ref G2::serializeMany(const G2*,size_t,char*,bool).
+     * @param n Number of elements.
+     * @param els Array where the @p n element values are to be stored.
+     * @param compressed Whether the data was compressed or not.
+     * @param threads Number of threads among which the decoding is
+     *   split, with PBC (see G2JointTable::multMany). With MIRACL,
+     *   this is a plain loop.
+     * @sa G2::serializeMany(const G2*,size_t,char*,bool)
+     */
+    static void deserializeMany(const char *data, size_t n, G2 *els,
+                                bool compressed = false, int threads = 1);
     /**
      * @brief Gets an element value from some data to hash.
      *
@@ -1084,6 +1547,18 @@ public:
      * @return Power @f$this^{other}@f$
      */
     GT operator^(const Fp &other) const;
+    /**
+     * @brief Inplace power operator.
+     * @param other Short exponent value.
+     * @return Reference to the modified element.
+     */
+    GT &operator^=(const ShortScalar &other);
+    /**
+     * @brief Power operator.
+     * @param other Short exponent value.
+     * @return Power @f$this^{other}@f$
+     */
+    GT operator^(const ShortScalar &other) const;
     /**
      * @brief Equality operator.
      * @param other Value with which to compare the current element.
@@ -1101,22 +1576,33 @@ public:
      *
      * The data memory space is to be allocated before calling
      * this function, and thus the parameter @p data should point
-     * to some accessible space containing at least @ref GT::getDataLen()
+     * to some accessible space containing at least @ref GT::getDataLen(bool)
      * available bytes.
      *
      * The data will always contain exactly the number of bytes
-     * returned by the @ref GT::getDataLen() function.
+     * returned by the @ref GT::getDataLen(bool) function called with
+     * the same @p compressed value.
      *
      * It can then be converted back to the corresponding element
-     * value thanks to the @ref GT::getValue(const char*) function.
+     * value thanks to the @ref GT::getValue(const char*,bool) function.
+     *
+     * @note Compressed data uses the torus parametrization of the
+     * elements of @f$\mathbb{G}_T@f$ and is twice smaller than raw data;
+     * compression and decompression both cost a field inversion. This is
+     * only available if hasGTCompression() returns `true` (with MIRACL);
+     * otherwise, asking for compressed data throws an exception.
      *
      * @param data Pointer to where the data is to be stored.
-     * @sa Fp::getDataLen()
-     * @sa Fp::getValue(const char*)
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
+     * @sa GT::getDataLen(bool)
+     * @sa GT::getValue(const char*,bool)
      */
-    void getData(char *data) const;
+    void getData(char *data, bool compressed = false) const;
     /**
      * @brief Writes this element to an output stream.
+     * @note The element is written in uncompressed form; compression is
+     *   only available through @ref GT::getData(char*,bool).
      * @warning The iostream based function do not necessarily work
      *   with the same data as the `getData`-based functions.
      * @param stream Output stream.
@@ -1224,29 +1710,73 @@ public:
      * @return A random element value.
      */
     static GT getRand();
+    /**
+     * @brief Gets several random elements.
+     *
+     * This is equivalent to calling GT::getRand() @p n times, but
+     * shares the cost of drawing the random values.
+     *
+     * @param els Array of @p n elements where the results are stored.
+     * @param n Number of elements.
+     * @sa GT::getRand()
+     */
+    static void getRandMany(GT *els, size_t n);
+    /**
+     * @brief Raises several elements to the same power.
+     *
+     * This is equivalent to setting each @p out[i] to
+     * @p els[i] ^ @p m. With PBC, the elements can be spread over
+     * several threads; otherwise, this is a plain loop.
+     * The arrays @p els and @p out may be the same.
+     *
+     * @param els Array of @p n elements to raise.
+     * @param n Number of elements.
+     * @param m Exponent.
+     * @param out Array of @p n elements where the results are stored.
+     * @param threads Number of threads to use, when the implementation
+     *   allows it (see G1JointTable::multMany).
+     */
+    static void powMany(const GT *els, size_t n, const Fp &m, GT *out,
+                        int threads = 1);
+    /**
+     * @brief Computes a product of powers with short exponents.
+     *
+     * This is equivalent to multiplying the @p els[i] ^ @p m[i], but all
+     * the factors share the same squarings.
+     *
+     * @param els Array of @p n elements.
+     * @param m Array of @p n short exponents.
+     * @param n Number of factors.
+     * @return The product @f$\prod_i els_i^{m_i}@f$.
+     */
+    static GT powProd(const GT *els, const ShortScalar *m, size_t n);
     /**
      * @brief Gets the length of an element's data.
      *
-     * @note This function always returns the same number.
+     * @note This function always returns the same number
+     * for the same value of the @p compressed parameter.
      *
+     * @param compressed Indicates whether the element data
+     *   is to be compressed or not.
      * @return Number of bytes needed to encode an element in GT.
-     * @sa GT::getDataLen()
-     * @sa Fp::getValue(const char*)
+     * @sa GT::getData(char*,bool)
+     * @sa GT::getValue(const char*,bool)
      */
-    static int getDataLen();
+    static int getDataLen(bool compressed = false);
     /**
      * @brief Gets an element value from its data.
      *
      * @p data should hold exactly what the function
-     * @ref GT::getData(char*) gives for the element
-     * to be reconstructed.
+     * @ref GT::getData(char*,bool) gives for the element
+     * to be reconstructed, for the same value of @p compressed.
      *
      * @param data Pointer to the data.
+     * @param compressed Whether the data was compressed or not.
      * @return The element value corresponding to that data.
-     * @sa GT::getDataLen()
-     * @sa GT::getData(char*)
+     * @sa GT::getDataLen(bool)
+     * @sa GT::getData(char*,bool)
      */
-    static GT getValue(const char *data);
+    static GT getValue(const char *data, bool compressed = false);
     /**
      * @brief Computes a pairing of two elements.
      * @param a @f$\mathbb{G}_1@f$ member.
@@ -1269,6 +1799,154 @@ private:
     SharedData *d;
 };
 
+/**
+ * @brief Precomputed table for linear combinations of two fixed
+ *   @f$\mathbb{G}_1@f$ elements.
+ *
+ * Evaluates @f$x\cdot a+y\cdot b@f$ for fixed elements @f$a@f$ and
+ * @f$b@f$ with a comb method that walks the bits of both scalars
+ * at once, so that the doublings are shared by the two terms.
+ *
+ * Copies of a table share the same precomputed data.
+ */
+class G1JointTable {
+public:
+    /**
+     * @brief Constructs an empty table.
+     *
+     * @warning Such a table is only meant to be assigned later;
+     *   do not call mult(const Fp&,const Fp&) on it.
+     */
+    inline G1JointTable();
+    /**
+     * @brief Builds the table of two base elements.
+     * @param a First base element.
+     * @param b Second base element.
+     */
+    G1JointTable(const G1 &a, const G1 &b);
+    /**
+     * @brief Performs a copy of a table.
+     * @param other The table to be copied.
+     */
+    inline G1JointTable(const G1JointTable &other);
+    /**
+     * @brief Releases memory.
+     */
+    inline ~G1JointTable();
+    /**
+     * @brief Assigns a new value to this table.
+     * @param other New value for the table.
+     * @return Reference to the current table.
+     */
+    inline G1JointTable &operator=(const G1JointTable &other);
+    /**
+     * @brief Checks whether this table is empty.
+     * @return `true` if it is empty, `false` otherwise.
+     */
+    inline bool isNull() const;
+    /**
+     * @brief Computes a linear combination of the two base elements.
+     * @param x Scalar for the first base element.
+     * @param y Scalar for the second base element.
+     * @return The element @f$x\cdot a+y\cdot b@f$.
+     */
+    G1 mult(const Fp &x, const Fp &y) const;
+    /**
+     * @brief Computes several linear combinations of the two base elements.
+     *
+     * Sets @p out[i] to @f$x_i\cdot a+y_i\cdot b@f$ for each
+     * @f$i<n@f$.
+     *
+     * @note The work is split among @p threads threads when the
+     *   implementation allows it (PBC). MIRACL keeps its state in global
+     *   variables, so this parameter is ignored there.
+     *
+     * @param x Scalars for the first base element.
+     * @param y Scalars for the second base element.
+     * @param n Number of combinations.
+     * @param out Array of @p n elements where the results are stored.
+     * @param threads Number of threads to use.
+     */
+    void multMany(const Fp *x, const Fp *y, size_t n, G1 *out,
+                  int threads = 1) const;
+private:
+    void deref();
+private:
+    SharedData *d;
+};
+
+/**
+ * @brief Precomputed table for linear combinations of two fixed
+ *   @f$\mathbb{G}_2@f$ elements.
+ *
+ * This is the @f$\mathbb{G}_2@f$ counterpart of G1JointTable.
+ */
+class G2JointTable {
+public:
+    /**
+     * @brief Constructs an empty table.
+     *
+     * @warning Such a table is only meant to be assigned later;
+     *   do not call mult(const Fp&,const Fp&) on it.
+     */
+    inline G2JointTable();
+    /**
+     * @brief Builds the table of two base elements.
+     * @param a First base element.
+     * @param b Second base element.
+     */
+    G2JointTable(const G2 &a, const G2 &b);
+    /**
+     * @brief Performs a copy of a table.
+     * @param other The table to be copied.
+     */
+    inline G2JointTable(const G2JointTable &other);
+    /**
+     * @brief Releases memory.
+     */
+    inline ~G2JointTable();
+    /**
+     * @brief Assigns a new value to this table.
+     * @param other New value for the table.
+     * @return Reference to the current table.
+     */
+    inline G2JointTable &operator=(const G2JointTable &other);
+    /**
+     * @brief Checks whether this table is empty.
+     * @return `true` if it is empty, `false` otherwise.
+     */
+    inline bool isNull() const;
+    /**
+     * @brief Computes a linear combination of the two base elements.
+     * @param x Scalar for the first base element.
+     * @param y Scalar for the second base element.
+     * @return The element @f$x\cdot a+y\cdot b@f$.
+     */
+    G2 mult(const Fp &x, const Fp &y) const;
+    /**
+     * @brief Computes several linear combinations of the two base elements.
+     *
+     * Sets @p out[i] to @f$x_i\cdot a+y_i\cdot b@f$ for each
+     * @f$i<n@f$.
+     *
+     * @note The work is split among @p threads threads when the
+     *   implementation allows it (PBC). MIRACL keeps its state in global
+     *   variables, so this parameter is ignored there.
+     *
+     * @param x Scalars for the first base element.
+     * @param y Scalars for the second base element.
+     * @param n Number of combinations.
+     * @param out Array of @p n elements where the results are stored.
+     * @param threads Number of threads to use.
+     */
+    void multMany(const Fp *x, const Fp *y, size_t n, G2 *out,
+                  int threads = 1) const;
+private:
+    void deref();
+private:
+    SharedData *d;
+};
+
 /* Inline definitions: */
 
 /**
@@ -1299,6 +1977,14 @@ inline Fp::Fp(void *v) : d(new SharedData(v)) {}
 
 inline Fp::Fp(SharedData *d) : d(d) { ++d->c; }
 
+inline ShortScalar::ShortScalar() : v(0) {}
+
+inline ShortScalar::ShortScalar(uint64_t v) : v(v) {}
+
+inline uint64_t ShortScalar::getValue() const { return v; }
+
+inline bool ShortScalar::isNull() const { return !v; }
+
 inline G1::G1() : d(NULL) {}
 
 inline G1::G1(const G1 &other) {
@@ -1392,6 +2078,38 @@ inline GT::GT(void *v) : d(new SharedData(v)) {}
 
 inline GT::GT(SharedData *d) : d(d) { ++d->c; }
 
+inline G1JointTable::G1JointTable() : d(NULL) {}
+
+inline G1JointTable::G1JointTable(const G1JointTable &other) {
+    if ((d = other.d)) ++d->c;
+}
+
+inline G1JointTable::~G1JointTable() { if (d) deref(); }
+
+inline G1JointTable &G1JointTable::operator=(const G1JointTable &other) {
+    if (d) deref();
+    if ((d = other.d)) ++d->c;
+    return *this;
+}
+
+inline bool G1JointTable::isNull() const { return !d; }
+
+inline G2JointTable::G2JointTable() : d(NULL) {}
+
+inline G2JointTable::G2JointTable(const G2JointTable &other) {
+    if ((d = other.d)) ++d->c;
+}
+
+inline G2JointTable::~G2JointTable() { if (d) deref(); }
+
+inline G2JointTable &G2JointTable::operator=(const G2JointTable &other) {
+    if (d) deref();
+    if ((d = other.d)) ++d->c;
+    return *this;
+}
+
+inline bool G2JointTable::isNull() const { return !d; }
+
 /**
  * @endcond
  */
@@ -12,6 +12,17 @@
 
 #include "bigendian.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#if !defined(GSNIZK_NO_SHANI)
+#define SHA256_SHANI
+#include <cpuid.h>
+#endif
+#if !defined(GSNIZK_NO_AVX2)
+#define SHA256_AVX2
+#endif
+#include <immintrin.h>
+#endif
+
 /* Prioritize Qt's no-debug policy, if existent */
 #if defined(QT_NO_DEBUG) && defined(DEBUG)
 #undef DEBUG
@@ -82,30 +93,273 @@ void process_chunk(uint32_t *h, uint32_t *w) {
         h[i] += abc[i];
 }
 
-void hash_sha256(const char *data, int len, char *hash) {
-    ASSERT(len >= 0, "Negative length");
-#define myh reinterpret_cast<uint32_t*>(hash)
-    int r = len;
+static void process_blocks_generic(uint32_t *h, const unsigned char *data,
+                                   size_t n) {
     uint32_t w[64];
-    memcpy(hash, H, 32);
-    while (r >= 64) {
+    for (; n > 0; --n, data += 64) {
         memcpy(w, data, 64);
-        data += 64;
-        r -= 64;
-        process_chunk(myh, w);
+        process_chunk(h, w);
     }
-    memcpy(w, data, r);
-    reinterpret_cast<char*>(w)[r] = 0x80;
-    if (r <= 55) {
-        memset(reinterpret_cast<char*>(w) + r + 1, 0, 59 - r);
-        w[15] = htonl(len * 8);
-    } else {
-        memset(reinterpret_cast<char*>(w) + r + 1, 0, 63 - r);
-        process_chunk(myh, w);
-        memset(w, 0, 60);
-        w[15] = htonl(len * 8);
+}
+
+#ifdef SHA256_SHANI
+/* Same compression function, with the SHA extensions of x86 processors
+ * (the state is kept as the ABEF and CDGH halves they work on) */
+__attribute__((target("sha,sse4.1")))
+static void process_blocks_shani(uint32_t *h, const unsigned char *data,
+                                 size_t n) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    __m128i msg[4], abef, cdgh, k;
+    for (; n > 0; --n, data += 64) {
+        abef = state0;
+        cdgh = state1;
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(data + 16 * i));
+            msg[i] = _mm_shuffle_epi8(msg[i], mask);
+        }
+        for (int i = 0; i < 16; ++i) {
+            k = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(
+                                  reinterpret_cast<const __m128i*>(K + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+            k = _mm_shuffle_epi32(k, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, k);
+            if (i < 12) {
+                /* Words 4i+16 to 4i+19 of the message schedule */
+                tmp = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(msg[(i + 3) & 3],
+                                                         msg[(i + 2) & 3], 4));
+                msg[i & 3] = _mm_sha256msg2_epu32(tmp, msg[(i + 3) & 3]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
     }
-    process_chunk(myh, w);
-    for (int i = 8; i-- > 0;)
-        myh[i] = htonl(myh[i]);
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h + 4), state1);
+}
+
+static bool has_shani() {
+    unsigned int a, b, c, d;
+    if (__get_cpuid_max(0, 0) < 7)
+        return false;
+    __cpuid(1, a, b, c, d);
+    if (!(c & bit_SSE4_1) || !(c & bit_SSSE3))
+        return false;
+    __cpuid_count(7, 0, a, b, c, d);
+    return (b & (1U << 29)) != 0;
+}
+#endif /* SHA256_SHANI */
+
+static void process_blocks(uint32_t *h, const unsigned char *data, size_t n) {
+    typedef void (*BlockFunction)(uint32_t*, const unsigned char*, size_t);
+#ifdef SHA256_SHANI
+    static const BlockFunction f = has_shani() ? process_blocks_shani
+                                               : process_blocks_generic;
+#else
+    static const BlockFunction f = process_blocks_generic;
+#endif
+    f(h, data, n);
+}
+
+void sha256_init(sha256_ctx *ctx) {
+    memcpy(ctx->h, H, 32);
+    ctx->len = 0;
+}
+
+void sha256_update(sha256_ctx *ctx, const char *data, int len) {
+    ASSERT(len >= 0, "Negative length");
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+    size_t r = len, used = ctx->len & 63;
+    ctx->len += len;
+    if (used) {
+        if (r < 64 - used) {
+            memcpy(ctx->buf + used, p, r);
+            return;
+        }
+        memcpy(ctx->buf + used, p, 64 - used);
+        process_blocks(ctx->h, ctx->buf, 1);
+        p += 64 - used;
+        r -= 64 - used;
+    }
+    process_blocks(ctx->h, p, r >> 6);
+    memcpy(ctx->buf, p + (r & ~((size_t) 63)), r & 63);
+}
+
+void sha256_final(sha256_ctx *ctx, char *hash) {
+    size_t used = ctx->len & 63;
+    ctx->buf[used++] = 0x80;
+    if (used > 56) {
+        memset(ctx->buf + used, 0, 64 - used);
+        process_blocks(ctx->h, ctx->buf, 1);
+        used = 0;
+    }
+    memset(ctx->buf + used, 0, 56 - used);
+    uint64_t bits = ctx->len << 3;
+    for (int i = 0; i < 8; ++i)
+        ctx->buf[63 - i] = (unsigned char) (bits >> (8 * i));
+    process_blocks(ctx->h, ctx->buf, 1);
+    for (int i = 0; i < 8; ++i) {
+        uint32_t v = htonl(ctx->h[i]);
+        memcpy(hash + 4 * i, &v, 4);
+    }
+}
+
+void hash_sha256(const char *data, int len, char *hash) {
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, hash);
+}
+
+#ifdef SHA256_AVX2
+#define V_ADD(x,y)   _mm256_add_epi32(x,y)
+#define V_XOR3(x,y,z) _mm256_xor_si256(_mm256_xor_si256(x,y),z)
+#define V_S(n,x)     _mm256_or_si256(_mm256_srli_epi32(x,n), \
+                                     _mm256_slli_epi32(x,32-n))
+#define V_R(n,x)     _mm256_srli_epi32(x,n)
+#define V_Ch(x,y,z)  _mm256_xor_si256(_mm256_and_si256(x,y), \
+                                      _mm256_andnot_si256(x,z))
+#define V_Maj(x,y,z) V_XOR3(_mm256_and_si256(x,y),_mm256_and_si256(x,z), \
+                            _mm256_and_si256(y,z))
+#define V_Sig0(x)    V_XOR3(V_S(2,x),V_S(13,x),V_S(22,x))
+#define V_Sig1(x)    V_XOR3(V_S(6,x),V_S(11,x),V_S(25,x))
+#define V_theta0(x)  V_XOR3(V_S(7,x),V_S(18,x),V_R(3,x))
+#define V_theta1(x)  V_XOR3(V_S(17,x),V_S(19,x),V_R(10,x))
+
+static inline uint32_t load_be32(const unsigned char *p) {
+    return (((uint32_t) p[0]) << 24) | (((uint32_t) p[1]) << 16) |
+           (((uint32_t) p[2]) << 8) | ((uint32_t) p[3]);
+}
+
+/* Hashes up to 8 messages at once, one per 32-bit lane of the AVX2
+ * registers; a lane keeps its state once its message is over */
+__attribute__((target("avx2")))
+static void hash_lanes_avx2(const char **data, const int *len, int n,
+                            char *hash) {
+    unsigned char tail[8][128];
+    const unsigned char *p[8];
+    int full[8], total[8], maxBlocks = 0;
+    for (int l = 0; l < 8; ++l) {
+        if (l >= n) {
+            full[l] = total[l] = 0;
+            continue;
+        }
+        ASSERT(len[l] >= 0, "Negative length");
+        int r = len[l] & 63, tailLen = (r <= 55) ? 64 : 128;
+        full[l] = len[l] >> 6;
+        total[l] = full[l] + (tailLen >> 6);
+        if (total[l] > maxBlocks)
+            maxBlocks = total[l];
+        memcpy(tail[l], data[l] + (len[l] - r), r);
+        tail[l][r] = 0x80;
+        memset(tail[l] + r + 1, 0, tailLen - r - 1);
+        uint64_t bits = ((uint64_t) len[l]) << 3;
+        for (int i = 0; i < 8; ++i)
+            tail[l][tailLen - 1 - i] = (unsigned char) (bits >> (8 * i));
+    }
+    __m256i st[8], w[16], abc[8], t1, t2, active;
+    for (int i = 0; i < 8; ++i)
+        st[i] = _mm256_set1_epi32(H[i]);
+    for (int b = 0; b < maxBlocks; ++b) {
+        for (int l = 0; l < 8; ++l) {
+            if (b < full[l])
+                p[l] = reinterpret_cast<const unsigned char*>(data[l]) + 64 * b;
+            else if (b < total[l])
+                p[l] = tail[l] + 64 * (b - full[l]);
+            else
+                p[l] = tail[0];
+        }
+        active = _mm256_set_epi32(-(b < total[7]), -(b < total[6]),
+                                  -(b < total[5]), -(b < total[4]),
+                                  -(b < total[3]), -(b < total[2]),
+                                  -(b < total[1]), -(b < total[0]));
+        for (int j = 0; j < 16; ++j) {
+            w[j] = _mm256_set_epi32(load_be32(p[7] + 4 * j),
+                                    load_be32(p[6] + 4 * j),
+                                    load_be32(p[5] + 4 * j),
+                                    load_be32(p[4] + 4 * j),
+                                    load_be32(p[3] + 4 * j),
+                                    load_be32(p[2] + 4 * j),
+                                    load_be32(p[1] + 4 * j),
+                                    load_be32(p[0] + 4 * j));
+        }
+        memcpy(abc, st, sizeof(abc));
+        for (int i = 0; i < 64; ++i) {
+            if (i >= 16) {
+                w[i & 15] = V_ADD(V_ADD(V_theta1(w[(i - 2) & 15]),
+                                        w[(i - 7) & 15]),
+                                  V_ADD(V_theta0(w[(i - 15) & 15]),
+                                        w[i & 15]));
+            }
+            t1 = V_ADD(V_ADD(abc[7], V_Sig1(abc[4])),
+                       V_ADD(V_Ch(abc[4], abc[5], abc[6]),
+                             V_ADD(_mm256_set1_epi32(K[i]), w[i & 15])));
+            t2 = V_ADD(V_Sig0(abc[0]), V_Maj(abc[0], abc[1], abc[2]));
+            for (int j = 7; j > 0; --j)
+                abc[j] = abc[j - 1];
+            abc[0] = V_ADD(t1, t2);
+            abc[4] = V_ADD(abc[4], t1);
+        }
+        for (int i = 0; i < 8; ++i)
+            st[i] = _mm256_blendv_epi8(st[i], V_ADD(st[i], abc[i]), active);
+    }
+    uint32_t out[8][8];
+    for (int i = 0; i < 8; ++i)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out[i]), st[i]);
+    for (int l = 0; l < n; ++l) {
+        for (int i = 0; i < 8; ++i) {
+            uint32_t v = htonl(out[i][l]);
+            memcpy(hash + 32 * l + 4 * i, &v, 4);
+        }
+    }
+}
+#endif /* SHA256_AVX2 */
+
+bool hash_sha256_lanes(const char **data, const int *len, int n,
+                       char *hash) {
+#ifdef SHA256_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (!avx2)
+        return false;
+    for (; n > 0; n -= 8, data += 8, len += 8, hash += 8 * 32)
+        hash_lanes_avx2(data, len, (n < 8) ? n : 8, hash);
+    return true;
+#else
+    (void) data;
+    (void) len;
+    (void) n;
+    (void) hash;
+    return false;
+#endif
+}
+
+void hash_sha256_many(const char **data, const int *len, int n, char *hash) {
+#ifdef SHA256_AVX2
+    /* The SHA extensions beat 8 lanes of plain AVX2 arithmetic */
+#ifdef SHA256_SHANI
+    static const bool lanes = __builtin_cpu_supports("avx2") && !has_shani();
+#else
+    static const bool lanes = __builtin_cpu_supports("avx2");
+#endif
+    if (lanes) {
+        for (; n > 1; n -= 8, data += 8, len += 8, hash += 8 * 32)
+            hash_lanes_avx2(data, len, (n < 8) ? n : 8, hash);
+        if (n <= 0)
+            return;
+    }
+#endif
+    for (; n > 0; --n, hash += 32)
+        hash_sha256(*(data++), *(len++), hash);
 }
@@ -6,6 +6,44 @@
 #ifndef SHA256_H
 #define SHA256_H
 
+#include <cstdint>
+
+/**
+ * @brief State of an incremental SHA-256 computation.
+ */
+struct sha256_ctx {
+    uint32_t h[8];          /**< Intermediate hash value. */
+    uint64_t len;           /**< Number of bytes processed so far. */
+    unsigned char buf[64];  /**< Pending bytes of the current block. */
+};
+
+/**
+ * @brief Starts an incremental SHA-256 computation.
+ * @param ctx State to initialize.
+ */
+void sha256_init(sha256_ctx *ctx);
+
+/**
+ * @brief Appends some data to an incremental SHA-256 computation.
+ * @param ctx State of the computation.
+ * @param data Pointer to the data to hash.
+ * @param len Length of the data to hash.
+ */
+void sha256_update(sha256_ctx *ctx, const char *data, int len);
+
+/**
+ * @brief Ends an incremental SHA-256 computation.
+ *
+ * The parameter @p hash should point to some accessible
+ * space containing at least 32 available bytes.
+ * The state @p ctx has to be initialized again before
+ * being reused.
+ *
+ * @param ctx State of the computation.
+ * @param hash Pointer to where the hash is to be stored.
+ */
+void sha256_final(sha256_ctx *ctx, char *hash);
+
 /**
  * @brief Hashes some data.
  *
@@ -22,4 +60,35 @@
  */
 void hash_sha256(const char *data, int len, char *hash);
 
+/**
+ * @brief Hashes several independent messages.
+ *
+ * The hash of the i-th message is stored at @p hash + 32 * i, so
+ * that @p hash should point to some accessible space containing at
+ * least 32 * @p n available bytes. When available, several messages
+ * are hashed at once in the lanes of vector registers.
+ *
+ * @param data Pointers to the messages to hash.
+ * @param len Lengths of the messages to hash.
+ * @param n Number of messages.
+ * @param hash Pointer to where the hashes are to be stored.
+ */
+void hash_sha256_many(const char **data, const int *len, int n, char *hash);
+
+/**
+ * @brief Hashes several messages in the lanes of AVX2 registers.
+ *
+ * This gives the same hashes as hash_sha256_many(), with the lane
+ * kernel that it only uses when the SHA extensions are missing; it is
+ * mainly useful to test this kernel on any machine supporting AVX2.
+ *
+ * @param data Pointers to the messages to hash.
+ * @param len Lengths of the messages to hash.
+ * @param n Number of messages.
+ * @param hash Pointer to where the hashes are to be stored.
+ * @return Whether AVX2 is available; nothing is hashed otherwise.
+ */
+bool hash_sha256_lanes(const char **data, const int *len, int n,
+                       char *hash);
+
 #endif /* End of SHA256_H */
@@ -108,30 +108,65 @@ void process_chunk(uint64_t *h, uint64_t *w) {
         h[i] += abc[i];
 }
 
-void hash_sha512(const char *data, int len, char *hash) {
-    ASSERT(len >= 0, "Negative length");
-#define myh reinterpret_cast<uint64_t*>(hash)
-    int r = len;
+static void process_blocks(uint64_t *h, const unsigned char *data, size_t n) {
     uint64_t w[80];
-    memcpy(hash, H, 64);
-    while (r >= 128) {
+    for (; n > 0; --n, data += 128) {
         memcpy(w, data, 128);
-        data += 128;
-        r -= 128;
-        process_chunk(myh, w);
+        process_chunk(h, w);
     }
-    memcpy(w, data, r);
-    reinterpret_cast<char*>(w)[r] = 0x80;
-    if (r <= 111) {
-        memset(reinterpret_cast<char*>(w) + r + 1, 0, 123 - r);
-        reinterpret_cast<uint32_t*>(w)[31] = htonl(len * 8);
-    } else {
-        memset(reinterpret_cast<char*>(w) + r + 1, 0, 127 - r);
-        process_chunk(myh, w);
-        memset(w, 0, 124);
-        reinterpret_cast<uint32_t*>(w)[31] = htonl(len * 8);
+}
+
+void sha512_init(sha512_ctx *ctx) {
+    memcpy(ctx->h, H, 64);
+    ctx->len = 0;
+}
+
+void sha512_update(sha512_ctx *ctx, const char *data, int len) {
+    ASSERT(len >= 0, "Negative length");
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+    size_t r = len, used = ctx->len & 127;
+    ctx->len += len;
+    if (used) {
+        if (r < 128 - used) {
+            memcpy(ctx->buf + used, p, r);
+            return;
+        }
+        memcpy(ctx->buf + used, p, 128 - used);
+        process_blocks(ctx->h, ctx->buf, 1);
+        p += 128 - used;
+        r -= 128 - used;
     }
-    process_chunk(myh, w);
-    for (int i = 8; i-- > 0;)
-        myh[i] = htonll(myh[i]);
+    process_blocks(ctx->h, p, r >> 7);
+    memcpy(ctx->buf, p + (r & ~((size_t) 127)), r & 127);
+}
+
+void sha512_final(sha512_ctx *ctx, char *hash) {
+    size_t used = ctx->len & 127;
+    ctx->buf[used++] = 0x80;
+    if (used > 112) {
+        memset(ctx->buf + used, 0, 128 - used);
+        process_blocks(ctx->h, ctx->buf, 1);
+        used = 0;
+    }
+    memset(ctx->buf + used, 0, 120 - used);
+    uint64_t bits = ctx->len << 3;
+    for (int i = 0; i < 8; ++i)
+        ctx->buf[127 - i] = (unsigned char) (bits >> (8 * i));
+    process_blocks(ctx->h, ctx->buf, 1);
+    for (int i = 0; i < 8; ++i) {
+        uint64_t v = htonll(ctx->h[i]);
+        memcpy(hash + 8 * i, &v, 8);
+    }
+}
+
+void hash_sha512(const char *data, int len, char *hash) {
+    sha512_ctx ctx;
+    sha512_init(&ctx);
+    sha512_update(&ctx, data, len);
+    sha512_final(&ctx, hash);
+}
+
+void hash_sha512_many(const char **data, const int *len, int n, char *hash) {
+    for (; n > 0; --n, hash += 64)
+        hash_sha512(*(data++), *(len++), hash);
 }
@@ -6,6 +6,44 @@
 #ifndef SHA512_H
 #define SHA512_H
 
+#include <cstdint>
+
+/**
+ * @brief State of an incremental SHA-512 computation.
+ */
+struct sha512_ctx {
+    uint64_t h[8];          /**< Intermediate hash value. */
+    uint64_t len;           /**< Number of bytes processed so far. */
+    unsigned char buf[128]; /**< Pending bytes of the current block. */
+};
+
+/**
+ * @brief Starts an incremental SHA-512 computation.
+ * @param ctx State to initialize.
+ */
+void sha512_init(sha512_ctx *ctx);
+
+/**
+ * @brief Appends some data to an incremental SHA-512 computation.
+ * @param ctx State of the computation.
+ * @param data Pointer to the data to hash.
+ * @param len Length of the data to hash.
+ */
+void sha512_update(sha512_ctx *ctx, const char *data, int len);
+
+/**
+ * @brief Ends an incremental SHA-512 computation.
+ *
+ * The parameter @p hash should point to some accessible
+ * space containing at least 64 available bytes.
+ * The state @p ctx has to be initialized again before
+ * being reused.
+ *
+ * @param ctx State of the computation.
+ * @param hash Pointer to where the hash is to be stored.
+ */
+void sha512_final(sha512_ctx *ctx, char *hash);
+
 /**
  * @brief Hashes some data.
  *
@@ -22,4 +60,18 @@
  */
 void hash_sha512(const char *data, int len, char *hash);
 
+/**
+ * @brief Hashes several independent messages.
+ *
+ * The hash of the i-th message is stored at @p hash + 64 * i, so
+ * that @p hash should point to some accessible space containing at
+ * least 64 * @p n available bytes.
+ *
+ * @param data Pointers to the messages to hash.
+ * @param len Lengths of the messages to hash.
+ * @param n Number of messages.
+ * @param hash Pointer to where the hashes are to be stored.
+ */
+void hash_sha512_many(const char **data, const int *len, int n, char *hash);
+
 #endif /* End of SHA512_H */
@@ -6,8 +6,12 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstring>
 
 #include "gsnizk.h"
+#if HASH_LEN_BITS == 256
+#include "sha256.h"
+#endif
 
 using namespace std;
 using namespace gsnizk;
@@ -39,6 +43,8 @@ void testHash() {
     cout << "########## HASH TESTS ##########" << endl;
     srand(42);
     char *hash = new char[pairings::getHashLen()], *data = new char[256];
+    char *hash2 = new char[pairings::getHashLen()];
+    pairings::HashContext ctx;
     ofstream out("hashes.test");
     for (int i = 0; i < HASH_TESTS; ++i) {
         int len = rand() % 257;
@@ -46,8 +52,42 @@ void testHash() {
             data[j] = static_cast<char>(rand() & 0xFF);
         pairings::getHash(data, len, hash);
         out.write(hash, pairings::getHashLen());
+        int cut = i % (len + 1);
+        pairings::hashInit(ctx);
+        pairings::hashUpdate(ctx, data, cut);
+        pairings::hashUpdate(ctx, data + cut, len - cut);
+        pairings::hashFinal(ctx, hash2);
+        ASSERT(memcmp(hash, hash2, pairings::getHashLen()) == 0);
     }
     out.close();
+    const char *msgs[16];
+    int lens[16];
+    char *hashes = new char[16 * pairings::getHashLen()];
+    for (int i = 0; i < 16; ++i) {
+        msgs[i] = data + i;
+        lens[i] = 15 * i;
+    }
+    pairings::getHashMany(msgs, lens, 16, hashes);
+    for (int i = 0; i < 16; ++i) {
+        pairings::getHash(msgs[i], lens[i], hash);
+        ASSERT(memcmp(hash, hashes + i * pairings::getHashLen(),
+                      pairings::getHashLen()) == 0);
+    }
+#if HASH_LEN_BITS == 256
+    /* getHashMany skips the lane kernel when the SHA extensions are there,
+     * so it is checked directly, around the lengths where the padding
+     * takes one more block */
+    const int laneLens[8] = { 55, 56, 63, 64, 0, 119, 120, 128 };
+    if (hash_sha256_lanes(msgs, laneLens, 8, hashes)) {
+        for (int i = 0; i < 8; ++i) {
+            pairings::getHash(msgs[i], laneLens[i], hash);
+            ASSERT(memcmp(hash, hashes + i * pairings::getHashLen(),
+                          pairings::getHashLen()) == 0);
+        }
+    }
+#endif
+    delete[] hashes;
+    delete[] hash2;
     /* Note: The file "hashes" is useful to check that all implementations
      * produce the same hashes. This is however limited to the getHash
      * function that uses SHA256 or SHA512. */
@@ -83,6 +123,28 @@ void testPairings() {
         v2 = Fp::getValue(data);
         ASSERT(v1 == v2);
     }
+    CHECK_DATA_SIZE(len * TRANSFER_TESTS);
+    cout << "Testing bulk transfers..." << endl;
+    {
+        Fp els[TRANSFER_TESTS], back[TRANSFER_TESTS];
+        for (int i = 0; i < TRANSFER_TESTS; ++i)
+            els[i] = Fp::getRand();
+        Fp::serializeMany(els, TRANSFER_TESTS, data);
+        Fp::deserializeMany(data, TRANSFER_TESTS, back);
+        for (int i = 0; i < TRANSFER_TESTS; ++i)
+            ASSERT(els[i] == back[i]);
+    }
+    cout << "Testing seeded random values..." << endl;
+    {
+        Fp els[TRANSFER_TESTS], again[TRANSFER_TESTS];
+        pairings::setRandomSeed("seed", 4);
+        Fp::getRandMany(els, TRANSFER_TESTS);
+        pairings::setRandomSeed("seed", 4);
+        Fp::getRandMany(again, TRANSFER_TESTS);
+        for (int i = 0; i < TRANSFER_TESTS; ++i)
+            ASSERT(els[i] == again[i]);
+        ASSERT(els[0] != els[1]);
+    }
     v1 = Fp::getRand();
     v3 = (v1 / Fp(42)) * Fp(42);
     ASSERT(v1 == v3);
@@ -102,6 +164,10 @@ void testPairings() {
         g2 = G1::getValue(data);
         ASSERT(g1 == g2);
     }
+    // Note: Data that is not on the curve gives a null element
+    memset(data, 0, len);
+    data[len / 2 - 1] = data[len - 1] = 1;
+    ASSERT(G1::getValue(data).isNull());
     len = g1.getDataLen(true);
     cout << "Len for random G1 compressed: " << len << endl;
     CHECK_DATA_SIZE(len);
@@ -112,6 +178,31 @@ void testPairings() {
         g3 = G1::getValue(data, true);
         ASSERT(g1 == g3);
     }
+    CHECK_DATA_SIZE(G1::getDataLen() * TRANSFER_TESTS);
+    cout << "Testing bulk transfers..." << endl;
+    {
+        G1 els[TRANSFER_TESTS], back[TRANSFER_TESTS];
+        for (int i = 1; i < TRANSFER_TESTS; ++i)
+            els[i] = Fp::getRand() * G1::getRand();
+        for (int c = 0; c < 2; ++c) {
+            memset(data, 0x55, G1::getDataLen(c != 0) * TRANSFER_TESTS);
+            G1::serializeMany(els, TRANSFER_TESTS, data, c != 0);
+            /* The slot of the null element is fully written */
+            for (int i = 1; c && (i < G1::getDataLen(true)); ++i)
+                ASSERT(!data[i]);
+            G1::deserializeMany(data, TRANSFER_TESTS, back, c != 0);
+            for (int i = 0; i < TRANSFER_TESTS; ++i)
+                ASSERT(els[i] == back[i]);
+        }
+        cout << "Testing cached decompression..." << endl;
+        pairings::setPointCacheSize(TRANSFER_TESTS / 2);
+        for (int k = 0; k < 2; ++k) {
+            G1::deserializeMany(data, TRANSFER_TESTS, back, true, 2 * k + 1);
+            for (int i = 0; i < TRANSFER_TESTS; ++i)
+                ASSERT(els[i] == back[i]);
+        }
+        pairings::setPointCacheSize(0);
+    }
     g1 = G1::getRand();
     g3 = g1;
     g3 += g3;
@@ -120,6 +211,56 @@ void testPairings() {
     ASSERT((g1 - g1).isNull());
     ASSERT(G1::fromHash("hello", 5) != G1::fromHash("hi", 2));
     ASSERT(G1::fromHash("hello", 5) == G1::fromHash(hash));
+    {
+        G1 els[TRANSFER_TESTS];
+        G1::getRandMany(els, TRANSFER_TESTS);
+        ASSERT(els[0] != els[1]);
+        for (int i = 0; i < TRANSFER_TESTS; ++i) {
+            els[i].getData(data, true);
+            ASSERT(G1::getValue(data, true) == els[i]);
+        }
+    }
+    {
+        const char *msgs[3] = { "hello", "hi", "" };
+        int lens[3] = { 5, 2, 0 };
+        G1 els[3];
+        G1::fromHashMany(msgs, lens, 3, els);
+        for (int i = 0; i < 3; ++i)
+            ASSERT(els[i] == G1::fromHash(msgs[i], lens[i]));
+    }
+    {
+        G1 els[4], res[4];
+        G1::getRandMany(els + 1, 3);
+        v1 = Fp::getRand();
+        G1::mulMany(els, 4, v1, res);
+        for (int i = 0; i < 4; ++i)
+            ASSERT(res[i] == (v1 * els[i]));
+        G1::mulMany(els, 4, v1, els);
+        for (int i = 0; i < 4; ++i)
+            ASSERT(res[i] == els[i]);
+    }
+    {
+        G1 els[4], sum;
+        pairings::ShortScalar m[4];
+        G1::getRandMany(els + 1, 3);
+        pairings::ShortScalar::getRandMany(m, 3);
+        for (int i = 0; i < 4; ++i)
+            sum += m[i].toFp() * els[i];
+        ASSERT(G1::mulSum(els, m, 4) == sum);
+        ASSERT((m[1] * els[1]) == (m[1].toFp() * els[1]));
+        ASSERT(G1::mulSum(els, m + 3, 1).isNull());
+    }
+    {
+        g1 = G1::getRand();
+        g2 = G1::getRand();
+        pairings::G1JointTable tab(g1, g2);
+        for (int i = 0; i < TRANSFER_TESTS; ++i) {
+            v1 = Fp::getRand();
+            v2 = Fp::getRand();
+            ASSERT(tab.mult(v1, v2) == (v1 * g1 + v2 * g2));
+        }
+        ASSERT(tab.mult(Fp(), Fp()).isNull());
+    }
     g1 = G1::getRand();
     v1 = Fp::getRand();
     g2 = v1 * g1;
@@ -145,6 +286,10 @@ void testPairings() {
         h2 = G2::getValue(data);
         ASSERT(h1 == h2);
     }
+    // Note: Data that is not on the curve gives a null element
+    memset(data, 0, len);
+    data[len / 2 - 1] = data[len - 1] = 1;
+    ASSERT(G2::getValue(data).isNull());
     len = h1.getDataLen(true);
     cout << "Len for random G2 compressed: " << len << endl;
     CHECK_DATA_SIZE(len);
@@ -155,6 +300,23 @@ void testPairings() {
         h2 = G2::getValue(data, true);
         ASSERT(h1 == h2);
     }
+    CHECK_DATA_SIZE(G2::getDataLen() * TRANSFER_TESTS);
+    cout << "Testing bulk transfers..." << endl;
+    {
+        G2 els[TRANSFER_TESTS], back[TRANSFER_TESTS];
+        for (int i = 1; i < TRANSFER_TESTS; ++i)
+            els[i] = Fp::getRand() * G2::getRand();
+        for (int c = 0; c < 2; ++c) {
+            memset(data, 0x55, G2::getDataLen(c != 0) * TRANSFER_TESTS);
+            G2::serializeMany(els, TRANSFER_TESTS, data, c != 0);
+            /* The slot of the null element is fully written */
+            for (int i = 1; c && (i < G2::getDataLen(true)); ++i)
+                ASSERT(!data[i]);
+            G2::deserializeMany(data, TRANSFER_TESTS, back, c != 0, 3);
+            for (int i = 0; i < TRANSFER_TESTS; ++i)
+                ASSERT(els[i] == back[i]);
+        }
+    }
     h1 = G2::getRand();
     h3 = h1;
     h3 += h3;
@@ -163,6 +325,15 @@ void testPairings() {
     ASSERT((h1 - h1).isNull());
     ASSERT(G2::fromHash("hello", 5) != G2::fromHash("hi", 2));
     ASSERT(G2::fromHash("hello", 5) == G2::fromHash(hash));
+    {
+        G2 els[TRANSFER_TESTS];
+        G2::getRandMany(els, TRANSFER_TESTS);
+        ASSERT(els[0] != els[1]);
+        for (int i = 0; i < TRANSFER_TESTS; ++i) {
+            els[i].getData(data, true);
+            ASSERT(G2::getValue(data, true) == els[i]);
+        }
+    }
     h1 = G2::getRand();
     v1 = Fp::getRand();
     h2 = v1 * h1;
@@ -179,6 +350,20 @@ void testPairings() {
     ASSERT(t1 != t2); // Note: Just highly unlikely if the randomness is fine
     t2 = GT::getRand();
     ASSERT(t1 != t2); // Note: Just highly unlikely if the randomness is fine
+    {
+        GT els[2];
+        GT::getRandMany(els, 2);
+        ASSERT(els[0] != els[1]);
+    }
+    {
+        GT els[3], prod;
+        pairings::ShortScalar m[3];
+        GT::getRandMany(els, 3);
+        pairings::ShortScalar::getRandMany(m, 3);
+        for (int i = 0; i < 3; ++i)
+            prod *= els[i] ^ m[i].toFp();
+        ASSERT(GT::powProd(els, m, 3) == prod);
+    }
     len = t1.getDataLen();
     cout << "Len for random GT: " << len << endl;
     CHECK_DATA_SIZE(len);
@@ -189,6 +374,30 @@ void testPairings() {
         t2 = GT::getValue(data);
         ASSERT(t1 == t2);
     }
+    if (pairings::hasGTCompression()) {
+        len = t1.getDataLen(true);
+        cout << "Len for random GT compressed: " << len << endl;
+        CHECK_DATA_SIZE(len);
+        cout << "Testing transfers..." << endl;
+        for (int i = 0; i < TRANSFER_TESTS; ++i) {
+            t1 = GT::getRand();
+            t1.getData(data, true);
+            t2 = GT::getValue(data, true);
+            ASSERT(t1 == t2);
+        }
+        t1.clear();
+        t1.getData(data, true);
+        ASSERT(GT::getValue(data, true).isUnit());
+    } else {
+        /* Asking for compressed data must not silently give raw data */
+        bool thrown = false;
+        try {
+            GT::getDataLen(true);
+        } catch (const char *) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
     t1 = GT::getRand();
     t3 = t1;
     t3 *= t3;
@@ -279,14 +488,49 @@ void testPairings() {
     ASSERT(t2 == t4);
 }
 
+/* Writes uncompressed G1 data that is not on the curve */
+void putInvalidG1(char *data) {
+    int len = G1::getDataLen(false);
+    memset(data, 0, len);
+    data[len / 2 - 1] = data[len - 1] = 1;
+}
+
+/* Checks that a proof is rejected, without any exception being thrown */
+bool isRejected(const NIZKProof &proof, const char *data, size_t len,
+                const CRS &crs, const ProofData &d) {
+    try {
+        return !proof.checkProof(data, len, crs, d);
+    } catch (...) {
+        return false;
+    }
+}
+
+/* Checks the operation counts estimated for a proof */
+bool hasCost(const NIZKProof &proof, const CRS &crs, int multsG1,
+             int multsG2, int pairings, int pairingProducts) {
+    ProofCost cost = proof.estimateCost(crs);
+    return (cost.proverMultsG1 == multsG1) &&
+            (cost.proverMultsG2 == multsG2) &&
+            (cost.verifierPairings == pairings) &&
+            (cost.verifierPairingProducts == pairingProducts);
+}
+
 void testProof(NIZKProof &proof, ProofData &d, const CRS &crs, CRS *verif = 0) {
     ASSERT(proof.verifySolution(d, crs));
+    ASSERT(proof.verifySolution(d, crs, true));
     {
         cout << " * Creating and writing proof..." << endl;
         ofstream out("proof.test");
         proof.writeProof(out, crs, d);
         out.close();
     }
+    vector<char> buf(proof.proofSize());
+    size_t len;
+    {
+        cout << " * Creating and writing proof to a buffer..." << endl;
+        len = proof.writeProof(buf.data(), buf.size(), crs, d);
+        ASSERT((len > 0) && (len <= buf.size()));
+    }
     d.privFp.clear();
     d.privG1.clear();
     d.privG2.clear();
@@ -300,6 +544,22 @@ void testProof(NIZKProof &proof, ProofData &d, const CRS &crs, CRS *verif = 0) {
         }
         in.close();
     }
+    {
+        cout << " * Checking proof from the buffer..." << endl;
+        ASSERT(proof.checkProof(buf.data(), len, verif ? *verif : crs, d));
+    }
+    {
+        cout << " * Checking damaged buffers..." << endl;
+        const CRS &c = verif ? *verif : crs;
+        vector<char> damaged(buf.begin(), buf.begin() + (len - 1));
+        ASSERT(isRejected(proof, damaged.data(), len - 1, c, d));
+        damaged.push_back(buf[len - 1]);
+        damaged.push_back(0);
+        ASSERT(isRejected(proof, damaged.data(), len + 1, c, d));
+        damaged.pop_back();
+        damaged[0] = static_cast<char>(0xFF);
+        ASSERT(isRejected(proof, damaged.data(), len, c, d));
+    }
     if (!(proof.isZeroKnowledge() && crs.isSimulationReady()))
         return;
     {
@@ -333,9 +593,59 @@ void testProofs() {
         in.close();
     }
     remove("crspriv.test");
+    {
+        CRS privs[3];
+        {
+            ofstream out("crspriv.test");
+            crsref.genPrivateMany(out, 3, privs, 2);
+            out.close();
+        }
+        {
+            ifstream in("crspriv.test");
+            ASSERT(crsref.checkPrivateMany(in, privs, 3));
+            in.close();
+        }
+        {
+            /* The proofs must not be valid for other private CRS */
+            ifstream in("crspriv.test");
+            swap(privs[0], privs[1]);
+            ASSERT(!crsref.checkPrivateMany(in, privs, 3));
+            in.close();
+        }
+        remove("crspriv.test");
+    }
     crspub = crspriv;
     crspub.makePublic();
 
+    cout << "Testing batched commitments..." << endl;
+    for (const CRS *c : { &crs, &crsref, &crspriv, &crspub }) {
+        Fp els[4], r[4], s[4];
+        B1 b1[4], res1[4];
+        B2 b2[4], res2[4];
+        Fp::getRandMany(els, 4);
+        Fp::getRandMany(r, 4);
+        Fp::getRandMany(s + 1, 3);
+        B1::commitMany(els, r, 4, *c, res1);
+        B2::commitMany(els, r, 4, *c, res2);
+        for (int i = 0; i < 4; ++i) {
+            ASSERT(res1[i] == B1::commit(els[i], r[i], *c));
+            ASSERT(res2[i] == B2::commit(els[i], r[i], *c));
+            b1[i] = B1(G1::getRand());
+            b2[i] = B2(G2::getRand());
+        }
+        B1::commitMany(b1, r, s, 4, *c, res1);
+        B2::commitMany(b2, r, s, 4, *c, res2);
+        for (int i = 0; i < 4; ++i) {
+            ASSERT(res1[i] == B1::commit(b1[i], r[i], s[i], *c));
+            ASSERT(res2[i] == B2::commit(b2[i], r[i], s[i], *c));
+        }
+        /* Note: s[0] is zero, hence a half-commitment */
+        B1::commitMany(b1, r, NULL, 4, *c, b1, 2);
+        B2::commitMany(b2, r, NULL, 4, *c, b2, 2);
+        ASSERT(b1[0] == res1[0]);
+        ASSERT(b2[0] == res2[0]);
+    }
+
     {
         cout << "Instantiation 1: discrete log in G1" << endl;
         cout << " * Creating the equation system..." << endl;
@@ -353,6 +663,12 @@ void testProofs() {
         d.pubG1.push_back(a);
         d.pubG1.push_back(b);
 
+        /* Prover: commitment of k in B2 (2 in G2), proof of the
+         * multi-scalar equation (1 in G1).
+         * Verifier: proof (1x2 pairings), left-hand side (1x2 pairings),
+         * right-hand side (1x2 pairings). */
+        ASSERT(hasCost(proof, crs, 1, 2, 6, 6));
+
         testProof(proof, d, crs);
     }
     {
@@ -438,6 +754,45 @@ void testProofs() {
         proof.addEquation(FpUnit() * _value, _sk_C * _v_SP);
         ASSERT(proof.endEquations());
 
+        cout << " * Checking wrong solutions..." << endl;
+        {
+            /* Wrong certificate, in the pairing product equation */
+            ProofData wrong = d;
+            wrong.privG1[1] = G1::getRand();
+            ASSERT(!proof.verifySolution(wrong, crs));
+            ASSERT(!proof.verifySolution(wrong, crs, true));
+            /* Wrong secret key, in the G1 and G2 equations */
+            wrong = d;
+            wrong.privFp[0] = wrong.privFp[0] + Fp(1);
+            ASSERT(!proof.verifySolution(wrong, crs));
+            ASSERT(!proof.verifySolution(wrong, crs, true));
+        }
+
+        cout << " * Checking the estimated proof size..." << endl;
+        {
+            ASSERT(proof.estimateCost(crs).proofSize == proof.proofSize());
+            vector<char> buf(proof.proofSize());
+            ASSERT(proof.writeProof(buf.data(), buf.size(), crs, d) <=
+                   proof.proofSize());
+            /* Without compression, all the elements have a fixed size */
+            NIZKProof raw(proof);
+            raw.setPointCompression(false);
+            ASSERT(raw.estimateCost(crs).proofSize == raw.proofSize());
+            buf.resize(raw.proofSize());
+            ASSERT(raw.writeProof(buf.data(), buf.size(), crs, d) ==
+                   raw.proofSize());
+        }
+
+        cout << " * Checking the estimated cost..." << endl;
+        /* sk_C is committed in B2 and its copy in B1, pk_C is committed
+         * and cert is only encrypted.
+         * Prover, in G1 / G2: commitments 6 / 2, pairing product
+         * equation 4 / 7, G1 equations 1 / 0 and 3 / 6, G2 equation
+         * 0 / 1, quadratic equation between the copies 4 / 4.
+         * Verifier, in pairings / products: 20 / 8, 6 / 6, 18 / 10,
+         * 6 / 6 and 16 / 12 in the same order. */
+        ASSERT(hasCost(proof, crs, 18, 22, 66, 42));
+
         testProof(proof, d, crs);
     }
     {
@@ -540,6 +895,181 @@ void testProofs() {
             G1 recovered_kg1 = c_kg1.extract(crs_extract);
             ASSERT(recovered_kg1 == kg1);
         }
+        cout << " * Extracting batched values..." << endl;
+        {
+            Fp r[3];
+            G1 g1s[3], back1[3];
+            G2 g2s[3], back2[3];
+            GT gts[3], backT[3];
+            B1 c1[3];
+            B2 c2[3];
+            BT cT[3];
+            Fp::getRandMany(r, 3);
+            G1::getRandMany(g1s, 3);
+            G2::getRandMany(g2s, 3);
+            for (int i = 0; i < 3; ++i) {
+                c1[i] = B1::commit(g1s[i], r[i], crs_extract);
+                c2[i] = B2::commit(g2s[i], r[i], crs_extract);
+                cT[i] = BT::pairing(c1[i], c2[i]);
+                gts[i] = GT::pairing(g1s[i], g2s[i]);
+            }
+            B1::extractMany(c1, 3, crs_extract, back1, 2);
+            B2::extractMany(c2, 3, crs_extract, back2, 2);
+            BT::extractMany(cT, 3, crs_extract, backT, 2);
+            for (int i = 0; i < 3; ++i) {
+                ASSERT(back1[i] == g1s[i]);
+                ASSERT(back2[i] == g2s[i]);
+                ASSERT(backT[i] == gts[i]);
+                ASSERT(backT[i] == cT[i].extract(crs_extract));
+            }
+            for (int c = 0; c < (pairings::hasGTCompression() ? 2 : 1); ++c) {
+                vector<char> buf(BT::getDataLen(c != 0));
+                cT[0].getData(buf.data(), c != 0);
+                ASSERT(BT::getValue(buf.data(), c != 0) == cT[0]);
+            }
+        }
+    }
+    {
+        cout << "Instantiation 7: Uncompressed proof with an invalid point"
+             << endl;
+        ProofData d;
+
+        G1 a = G1::getRand();
+        d.privG1.push_back(a);
+        d.pubG1.push_back(a);
+
+        NIZKProof proof;
+        proof.addEquation(e(G1Var(0), G2Base()), e(G1Const(0), G2Base()));
+        proof.setPointCompression(false);
+        ASSERT(proof.endEquations());
+        /* Prover: commitment of a (2 in G1), proof with an encrypted
+         * variable (4 in G1 and 3 in G2).
+         * Verifier: proof (12 pairings in 4 products), left-hand side
+         * (2x1 pairings), right-hand side (1x1 pairing). */
+        ASSERT(hasCost(proof, crs, 6, 3, 15, 7));
+
+        vector<char> buf(proof.proofSize());
+        size_t len = proof.writeProof(buf.data(), buf.size(), crs, d);
+        ASSERT(proof.checkProof(buf.data(), len, crs, d));
+        /* The first element of the proof is the first part of the
+         * commitment of a, which is replaced with data that is not on
+         * the curve */
+        putInvalidG1(buf.data());
+        ASSERT(!proof.checkProof(buf.data(), len, crs, d));
+    }
+    {
+        cout << "Instantiation 8: Automatic type of commitments" << endl;
+        ProofData d;
+
+        G1 a = G1::getRand();
+        Fp l = Fp::getRand();
+        d.privG1.push_back(a);
+        d.pubG2.push_back(l * crs.getG2Base());
+        d.pubG1.push_back(l * a);
+
+        CostWeights w = CostWeights::measure(2);
+        ASSERT((w.multG1 >= 0) && (w.multG2 >= 0) &&
+               (w.pairing >= 0) && (w.pairingProduct >= 0));
+        ASSERT((w.prover == 1) && (w.verifier == 1) && (w.proofByte == 0));
+
+        /* Encrypting the variable is not Zero-Knowledge here */
+        NIZKProof proof(NIZKProof::Auto);
+        proof.addEquation(e(G1Var(0), G2Const(0)), e(G1Const(0), G2Base()));
+        proof.setCostWeights(w, true);
+        ASSERT(proof.endEquations());
+        ASSERT(proof.isZeroKnowledge());
+
+        testProof(proof, d, crs);
+
+        /* An error that no type avoids is reported as such */
+        NIZKProof invalid(NIZKProof::Auto);
+        invalid.addEquation(FpConst(0) * G1Var(0), FpUnit() * G1Const(0));
+        invalid.addEquation(FpConst(0) * G2Var(0), FpUnit() * G2Const(0));
+        const char *error = NULL;
+        try {
+            invalid.endEquations();
+        } catch (const char *e) {
+            error = e;
+        }
+        ASSERT(error && !strcmp(error, "Fp constant used both in B1 and B2"));
+    }
+    {
+        cout << "Instantiation 9: Optimized placement of scalars" << endl;
+        cout << " * Creating the equation system..." << endl;
+        ProofData d;
+
+        Fp k = Fp::getRand(), l = Fp::getRand();
+        G1 a = G1::getRand();
+        G2 b = G2::getRand();
+        d.privFp.push_back(k);
+        d.privFp.push_back(l);
+        d.pubFp.push_back(k * l);
+        d.pubG1.push_back(a);
+        d.pubG1.push_back(k * a);
+        d.pubG2.push_back(b);
+        d.pubG2.push_back(l * b);
+
+        NIZKProof proof, proofcp;
+        proof.addEquation(FpVar(0) * FpVar(1), FpConst(0) * FpUnit());
+        proof.addEquation(FpVar(0) * G1Const(0), FpUnit() * G1Const(1));
+        proof.addEquation(FpVar(1) * G2Const(0), FpUnit() * G2Const(1));
+        proof.setOptimizedFpPlacement();
+        ASSERT(proof.endEquations());
+        /* k is committed in B2 and l in B1, without any copy.
+         * Prover, in G1 / G2: commitments 2 / 2, G1 equation 1 / 0,
+         * G2 equation 0 / 1, quadratic equation 4 / 4.
+         * Verifier, in pairings / products: 6 / 6 for each
+         * multi-scalar equation, 16 / 12 for the quadratic one. */
+        ASSERT(hasCost(proof, crs, 7, 7, 28, 24));
+
+        cout << " * Writing and reading back the equation system..." << endl;
+        {
+            ofstream out("proof-model.test");
+            out << proof;
+            out.close();
+        }
+        {
+            ifstream in("proof-model.test");
+            in >> proofcp;
+            in.close();
+        }
+        remove("proof-model.test");
+        ASSERT(proofcp.proofSize() == proof.proofSize());
+
+        testProof(proofcp, d, crs);
+    }
+    {
+        cout << "Instantiation 10: Lazy decoding of commitments" << endl;
+        ProofData d;
+
+        G1 a = G1::getRand(), b = G1::getRand();
+        d.privG1.push_back(a);
+        d.privG1.push_back(b);
+        d.pubG1.push_back(a);
+        d.pubG1.push_back(b);
+
+        /* Each commitment is only used by one of the equations */
+        NIZKProof proof;
+        proof.addEquation(e(G1Var(0), G2Base()), e(G1Const(0), G2Base()));
+        proof.addEquation(e(G1Var(1), G2Base()), e(G1Const(1), G2Base()));
+        proof.setPointCompression(false);
+        ASSERT(proof.endEquations());
+        /* Twice the cost of instantiation 7 */
+        ASSERT(hasCost(proof, crs, 12, 6, 30, 14));
+
+        vector<char> buf(proof.proofSize());
+        size_t len = proof.writeProof(buf.data(), buf.size(), crs, d);
+        d.privG1.clear();
+        ASSERT(proof.checkProof(buf.data(), len, crs, d));
+        /* The commitments of the variables are written in reverse order,
+         * and the one that fails to decode is only reached by the check
+         * of its equation */
+        int lenG1 = G1::getDataLen(false);
+        for (int i = 0; i < 2; ++i) {
+            vector<char> damaged(buf.begin(), buf.begin() + len);
+            putInvalidG1(damaged.data() + 2 * i * lenG1);
+            ASSERT(isRejected(proof, damaged.data(), len, crs, d));
+        }
     }
     remove("proof.test");
     remove("proof-sim.test");